@@ -824,7 +824,7 @@ class _ChessBoardState extends State<ChessBoard> {
             widget.bleManager.writeCharacteristic("clear_piece:$jumpedOverSquares");
           }
 
-          widget.bleManager.writeCharacteristic("move_cnc:$from$to");
+          widget.bleManager.writeCharacteristic("move_cnc:$from$to${promo ?? ""}");
           // Wait for the board to send the move via BLE
           _checkGameStatus();
           break;
@@ -0,0 +1,586 @@
+#include "BitBoard.h"
+#include "Magic.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <sstream>
+
+namespace {
+
+constexpr Bitboard stepMask(int square, const int (*steps)[2], int count) {
+    Bitboard mask = 0;
+    for (int i = 0; i < count; ++i) {
+        int file = fileOf(square) + steps[i][0];
+        int rank = rankOf(square) + steps[i][1];
+        if (file >= 0 && file < 8 && rank >= 0 && rank < 8) mask |= squareBit(rank * 8 + file);
+    }
+    return mask;
+}
+
+constexpr int KNIGHT_STEPS[8][2] = {{1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}};
+constexpr int KING_STEPS[8][2] = {{0, 1}, {1, 1}, {1, 0}, {1, -1}, {0, -1}, {-1, -1}, {-1, 0}, {-1, 1}};
+constexpr int PAWN_STEPS[2][2][2] = {{{-1, -1}, {1, -1}}, {{-1, 1}, {1, 1}}};
+
+constexpr std::array<Bitboard, 64> stepTable(const int (*steps)[2], int count) {
+    std::array<Bitboard, 64> table{};
+    for (int square = 0; square < 64; ++square) table[square] = stepMask(square, steps, count);
+    return table;
+}
+
+constexpr std::array<Bitboard, 64> KNIGHT_ATTACKS = stepTable(KNIGHT_STEPS, 8);
+constexpr std::array<Bitboard, 64> KING_ATTACKS = stepTable(KING_STEPS, 8);
+constexpr std::array<std::array<Bitboard, 64>, 2> PAWN_ATTACKS = {stepTable(PAWN_STEPS[Black], 2),
+                                                                  stepTable(PAWN_STEPS[White], 2)};
+
+// Castling rights that survive a move touching each square.
+constexpr std::array<uint8_t, 64> castlingMaskTable() {
+    std::array<uint8_t, 64> table{};
+    for (auto &mask : table) mask = ALL_CASTLING;
+    table[0] &= ~WHITE_QUEENSIDE;
+    table[4] &= ~(WHITE_KINGSIDE | WHITE_QUEENSIDE);
+    table[7] &= ~WHITE_KINGSIDE;
+    table[56] &= ~BLACK_QUEENSIDE;
+    table[60] &= ~(BLACK_KINGSIDE | BLACK_QUEENSIDE);
+    table[63] &= ~BLACK_KINGSIDE;
+    return table;
+}
+
+constexpr std::array<uint8_t, 64> CASTLING_MASK = castlingMaskTable();
+
+// BETWEEN holds the squares strictly between two aligned squares, LINE the whole line through them.
+constexpr std::array<std::array<Bitboard, 64>, 64> lineTable(bool wholeLine) {
+    std::array<std::array<Bitboard, 64>, 64> table{};
+    for (int from = 0; from < 64; ++from) {
+        for (int to = 0; to < 64; ++to) {
+            int fileDelta = fileOf(to) - fileOf(from);
+            int rankDelta = rankOf(to) - rankOf(from);
+            if (from == to || (fileDelta && rankDelta && fileDelta != rankDelta && fileDelta != -rankDelta)) continue;
+            int fileStep = (fileDelta > 0) - (fileDelta < 0);
+            int rankStep = (rankDelta > 0) - (rankDelta < 0);
+            Bitboard squares = 0;
+            if (wholeLine) {
+                int file = fileOf(from), rank = rankOf(from);
+                while (file - fileStep >= 0 && file - fileStep < 8 && rank - rankStep >= 0 && rank - rankStep < 8) {
+                    file -= fileStep;
+                    rank -= rankStep;
+                }
+                for (; file >= 0 && file < 8 && rank >= 0 && rank < 8; file += fileStep, rank += rankStep)
+                    squares |= squareBit(rank * 8 + file);
+            } else {
+                for (int square = from + rankStep * 8 + fileStep; square != to; square += rankStep * 8 + fileStep)
+                    squares |= squareBit(square);
+            }
+            table[from][to] = squares;
+        }
+    }
+    return table;
+}
+
+constexpr std::array<std::array<Bitboard, 64>, 64> BETWEEN = lineTable(false);
+constexpr std::array<std::array<Bitboard, 64>, 64> LINE = lineTable(true);
+
+// RAYS[direction][square] is the empty-board ray leaving square along KING_STEPS[direction].
+constexpr std::array<std::array<Bitboard, 64>, 8> rayTable() {
+    std::array<std::array<Bitboard, 64>, 8> table{};
+    for (int direction = 0; direction < 8; ++direction) {
+        for (int square = 0; square < 64; ++square) {
+            int file = fileOf(square) + KING_STEPS[direction][0];
+            int rank = rankOf(square) + KING_STEPS[direction][1];
+            for (; file >= 0 && file < 8 && rank >= 0 && rank < 8;
+                 file += KING_STEPS[direction][0], rank += KING_STEPS[direction][1])
+                table[direction][square] |= squareBit(rank * 8 + file);
+        }
+    }
+    return table;
+}
+
+constexpr std::array<std::array<Bitboard, 64>, 8> RAYS = rayTable();
+
+struct ZobristKeys {
+    std::array<std::array<uint64_t, 64>, 12> pieces;
+    std::array<uint64_t, 16> castling;
+    std::array<uint64_t, 8> enPassant;
+    uint64_t blackToMove;
+};
+
+constexpr uint64_t splitMix64(uint64_t &state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+constexpr ZobristKeys zobristKeys() {
+    ZobristKeys keys{};
+    uint64_t state = 0x5A0B715EEDULL;
+    for (auto &squares : keys.pieces)
+        for (auto &key : squares) key = splitMix64(state);
+    for (auto &key : keys.castling) key = splitMix64(state);
+    for (auto &key : keys.enPassant) key = splitMix64(state);
+    keys.blackToMove = splitMix64(state);
+    return keys;
+}
+
+constexpr ZobristKeys ZOBRIST = zobristKeys();
+
+// Indexed by PieceType and by CastlingRights bit respectively.
+constexpr char FEN_PIECES[] = "pnbrqk";
+constexpr char FEN_CASTLING[] = "KQkq";
+
+constexpr PieceType BACK_RANK[8] = {ROOK, KNIGHT, BISHOP, QUEEN, KING, BISHOP, KNIGHT, ROOK};
+
+constexpr Bitboard FIRST_AND_LAST_RANKS = 0xFF000000000000FFULL;
+
+// A FEN move counter: digits only, so "x" or "-3" is an error rather than a missing field.
+bool parseCount(const std::string &text, int &value) {
+    if (text.empty() || text.size() > 9) return false;
+    for (char c : text) {
+        if (!std::isdigit(static_cast<unsigned char>(c))) return false;
+    }
+    value = std::stoi(text);
+    return true;
+}
+
+} // namespace
+
+BitBoard::BitBoard() {
+    clear();
+}
+
+void BitBoard::clear() {
+    pieces.fill(0);
+    colors.fill(0);
+    mailbox.fill(EMPTY_SQUARE);
+    sideToMove = White;
+    castling = 0;
+    enPassant = NO_SQUARE;
+    halfmoveClock = 0;
+    fullmoveNumber = 1;
+    key = ZOBRIST.castling[0];
+}
+
+void BitBoard::setInitial() {
+    clear();
+    for (int file = 0; file < 8; ++file) {
+        put(makePiece(White, BACK_RANK[file]), file);
+        put(makePiece(White, PAWN), 8 + file);
+        put(makePiece(Black, PAWN), 48 + file);
+        put(makePiece(Black, BACK_RANK[file]), 56 + file);
+    }
+    setCastling(ALL_CASTLING);
+}
+
+bool BitBoard::setFEN(const std::string &fen) {
+    std::istringstream in(fen);
+    std::string placement, side, rights = "-", passant = "-", halfmoveText, fullmoveText;
+    int halfmoves = 0, fullmoves = 1;
+    if (!(in >> placement >> side)) return false;
+    in >> rights >> passant >> halfmoveText >> fullmoveText;
+    if (!halfmoveText.empty() && (!parseCount(halfmoveText, halfmoves) || !parseCount(fullmoveText, fullmoves)))
+        return false;
+    if (fullmoves < 1 || fullmoves > UINT16_MAX) return false;
+
+    BitBoard parsed;
+    int rank = 7, file = 0;
+    for (char c : placement) {
+        if (c == '/') {
+            if (file != 8 || rank == 0) return false;
+            --rank;
+            file = 0;
+        } else if (c >= '1' && c <= '8') {
+            file += c - '0';
+        } else {
+            const char *type = std::strchr(FEN_PIECES, std::tolower(c));
+            if (c == '\0' || type == nullptr || file > 7) return false;
+            parsed.put(makePiece(std::isupper(c) ? White : Black, static_cast<PieceType>(type - FEN_PIECES)), rank * 8 + file++);
+        }
+        if (file > 8) return false;
+    }
+    if (rank != 0 || file != 8) return false;
+    if (popCount(parsed.bitboard(White, KING)) != 1 || popCount(parsed.bitboard(Black, KING)) != 1) return false;
+    // No pawn can stand on either back rank.
+    if ((parsed.bitboard(White, PAWN) | parsed.bitboard(Black, PAWN)) & FIRST_AND_LAST_RANKS) return false;
+
+    if (side != "w" && side != "b") return false;
+    parsed.setSideToMove(side == "w" ? White : Black);
+
+    uint8_t castlingRights = 0;
+    for (char c : rights) {
+        const char *right = std::strchr(FEN_CASTLING, c);
+        if (c == '-' || c == '\0') continue;
+        if (right == nullptr) return false;
+        castlingRights |= 1 << (right - FEN_CASTLING);
+    }
+    // Drop rights the pieces can no longer have, so move generation never castles a missing rook.
+    for (int i = 0; i < 4; ++i) {
+        Color color = i < 2 ? White : Black;
+        int home = color == White ? 0 : 56;
+        int corner = home + (i % 2 == 0 ? 7 : 0);
+        if (parsed.at(home + 4) != makePiece(color, KING) || parsed.at(corner) != makePiece(color, ROOK))
+            castlingRights &= ~(1 << i);
+    }
+    parsed.setCastling(castlingRights);
+
+    if (passant != "-") {
+        if (passant.size() != 2 || passant[0] < 'a' || passant[0] > 'h' || (passant[1] != '3' && passant[1] != '6'))
+            return false;
+        parsed.setEnPassant((passant[1] - '1') * 8 + (passant[0] - 'a'));
+    }
+    parsed.halfmoveClock = std::min(halfmoves, int(UINT16_MAX));
+    parsed.fullmoveNumber = fullmoves;
+    *this = parsed;
+    return true;
+}
+
+std::string BitBoard::toFEN() const {
+    std::string fen;
+    for (int rank = 7; rank >= 0; --rank) {
+        int empty = 0;
+        for (int file = 0; file < 8; ++file) {
+            uint8_t piece = at(rank * 8 + file);
+            if (piece == EMPTY_SQUARE) {
+                ++empty;
+                continue;
+            }
+            if (empty) fen += char('0' + empty);
+            empty = 0;
+            char c = FEN_PIECES[typeOf(piece)];
+            fen += colorOf(piece) == White ? std::toupper(c) : c;
+        }
+        if (empty) fen += char('0' + empty);
+        if (rank) fen += '/';
+    }
+    fen += sideToMove == White ? " w " : " b ";
+    for (int i = 0; i < 4; ++i)
+        if (castling & (1 << i)) fen += FEN_CASTLING[i];
+    if (!castling) fen += '-';
+    if (enPassant == NO_SQUARE)
+        fen += " -";
+    else
+        fen += std::string{' ', char('a' + fileOf(enPassant)), char('1' + rankOf(enPassant))};
+    return fen + " " + std::to_string(halfmoveClock) + " " + std::to_string(fullmoveNumber);
+}
+
+void BitBoard::put(uint8_t piece, int square) {
+    pieces[piece] |= squareBit(square);
+    colors[colorOf(piece)] |= squareBit(square);
+    mailbox[square] = piece;
+    key ^= ZOBRIST.pieces[piece][square];
+}
+
+uint8_t BitBoard::remove(int square) {
+    uint8_t piece = mailbox[square];
+    if (piece == EMPTY_SQUARE) return piece;
+    pieces[piece] &= ~squareBit(square);
+    colors[colorOf(piece)] &= ~squareBit(square);
+    mailbox[square] = EMPTY_SQUARE;
+    key ^= ZOBRIST.pieces[piece][square];
+    return piece;
+}
+
+void BitBoard::setSideToMove(Color color) {
+    if (color != sideToMove) key ^= ZOBRIST.blackToMove;
+    sideToMove = color;
+}
+
+void BitBoard::setCastling(uint8_t rights) {
+    key ^= ZOBRIST.castling[castling] ^ ZOBRIST.castling[rights];
+    castling = rights;
+}
+
+void BitBoard::dropCastlingRights(int square) {
+    setCastling(castling & CASTLING_MASK[square]);
+}
+
+void BitBoard::setEnPassant(uint8_t square) {
+    if (enPassant != NO_SQUARE) key ^= ZOBRIST.enPassant[fileOf(enPassant)];
+    if (square != NO_SQUARE) key ^= ZOBRIST.enPassant[fileOf(square)];
+    enPassant = square;
+}
+
+uint64_t BitBoard::computeHash() const {
+    uint64_t result = ZOBRIST.castling[castling];
+    for (int square = 0; square < 64; ++square)
+        if (mailbox[square] != EMPTY_SQUARE) result ^= ZOBRIST.pieces[mailbox[square]][square];
+    if (enPassant != NO_SQUARE) result ^= ZOBRIST.enPassant[fileOf(enPassant)];
+    if (sideToMove == Black) result ^= ZOBRIST.blackToMove;
+    return result;
+}
+
+int BitBoard::kingSquare(Color color) const {
+    Bitboard king = bitboard(color, KING);
+    return king ? lsb(king) : NO_SQUARE;
+}
+
+Bitboard BitBoard::slidingAttacks(int square, int fileStep, int rankStep) const {
+    Bitboard result = 0;
+    int file = fileOf(square) + fileStep;
+    int rank = rankOf(square) + rankStep;
+    while (file >= 0 && file < 8 && rank >= 0 && rank < 8) {
+        Bitboard bit = squareBit(rank * 8 + file);
+        result |= bit;
+        if (occupied() & bit) break;
+        file += fileStep;
+        rank += rankStep;
+    }
+    return result;
+}
+
+Bitboard BitBoard::rayAttacks(int square, int fileStep, int rankStep) const {
+    for (int direction = 0; direction < 8; ++direction) {
+        if (KING_STEPS[direction][0] != fileStep || KING_STEPS[direction][1] != rankStep) continue;
+        Bitboard lines = fileStep && rankStep ? bishopAttacks(square, occupied()) : rookAttacks(square, occupied());
+        return lines & RAYS[direction][square];
+    }
+    return 0;
+}
+
+Bitboard BitBoard::attacks(int square) const {
+    uint8_t piece = mailbox[square];
+    if (piece == EMPTY_SQUARE) return 0;
+    switch (typeOf(piece)) {
+    case PAWN:
+        return PAWN_ATTACKS[colorOf(piece)][square];
+    case KNIGHT:
+        return KNIGHT_ATTACKS[square];
+    case KING:
+        return KING_ATTACKS[square];
+    case BISHOP:
+        return bishopAttacks(square, occupied());
+    case ROOK:
+        return rookAttacks(square, occupied());
+    case QUEEN:
+        return queenAttacks(square, occupied());
+    }
+    return 0;
+}
+
+Bitboard BitBoard::attackedBy(Color color) const {
+    Bitboard result = 0;
+    Bitboard own = colors[color];
+    while (own) result |= attacks(popLsb(own));
+    return result;
+}
+
+Bitboard BitBoard::attackersTo(int square, Color color, Bitboard occupancy) const {
+    Bitboard diagonal = bitboard(color, BISHOP) | bitboard(color, QUEEN);
+    Bitboard straight = bitboard(color, ROOK) | bitboard(color, QUEEN);
+    return (PAWN_ATTACKS[opposite(color)][square] & bitboard(color, PAWN)) |
+           (KNIGHT_ATTACKS[square] & bitboard(color, KNIGHT)) | (KING_ATTACKS[square] & bitboard(color, KING)) |
+           (bishopAttacks(square, occupancy) & diagonal) | (rookAttacks(square, occupancy) & straight);
+}
+
+bool BitBoard::isAttacked(int square, Color color) const {
+    return attackersTo(square, color, occupied()) != 0;
+}
+
+bool BitBoard::isCheck(Color color) const {
+    int king = kingSquare(color);
+    return king != NO_SQUARE && isAttacked(king, opposite(color));
+}
+
+CheckInfo BitBoard::checkInfo(Color color) const {
+    CheckInfo info;
+    int king = kingSquare(color);
+    if (king == NO_SQUARE) return info;
+    Color enemy = opposite(color);
+
+    info.checkers = attackersTo(king, enemy, occupied());
+    if (popCount(info.checkers) > 1)
+        info.evasions = 0;
+    else if (info.checkers)
+        info.evasions = info.checkers | BETWEEN[king][lsb(info.checkers)];
+
+    // Enemy sliders that would see the king through our own pieces.
+    Bitboard snipers = (rookAttacks(king, colors[enemy]) & (bitboard(enemy, ROOK) | bitboard(enemy, QUEEN))) |
+                       (bishopAttacks(king, colors[enemy]) & (bitboard(enemy, BISHOP) | bitboard(enemy, QUEEN)));
+    while (snipers) {
+        Bitboard blockers = BETWEEN[king][popLsb(snipers)] & occupied();
+        if (popCount(blockers) == 1 && (blockers & colors[color])) info.pinned |= blockers;
+    }
+    return info;
+}
+
+Bitboard BitBoard::pseudoTargets(int square) const {
+    uint8_t piece = mailbox[square];
+    if (piece == EMPTY_SQUARE) return 0;
+    Color color = colorOf(piece);
+    Color enemy = opposite(color);
+    Bitboard empty = ~occupied();
+
+    if (typeOf(piece) == PAWN) {
+        // A pawn on its last rank has nowhere to go. It can only come from a position built by hand, such as
+        // one read off the board's tags.
+        if (rankOf(square) == (color == White ? 7 : 0)) return 0;
+        int forward = color == White ? 8 : -8;
+        int startRank = color == White ? 1 : 6;
+        Bitboard targets = 0;
+        if (empty & squareBit(square + forward)) {
+            targets |= squareBit(square + forward);
+            if (rankOf(square) == startRank && (empty & squareBit(square + 2 * forward)))
+                targets |= squareBit(square + 2 * forward);
+        }
+        Bitboard capturable = colors[enemy];
+        if (enPassant != NO_SQUARE && mailbox[enPassant - forward] == makePiece(enemy, PAWN))
+            capturable |= squareBit(enPassant);
+        return targets | (PAWN_ATTACKS[color][square] & capturable);
+    }
+
+    Bitboard targets = attacks(square) & ~colors[color];
+    if (typeOf(piece) == KING) {
+        uint8_t kingside = color == White ? WHITE_KINGSIDE : BLACK_KINGSIDE;
+        uint8_t queenside = color == White ? WHITE_QUEENSIDE : BLACK_QUEENSIDE;
+        uint8_t rook = makePiece(color, ROOK);
+        bool home = square == (color == White ? 4 : 60);
+        if (home && (castling & (kingside | queenside)) && !isAttacked(square, enemy)) {
+            if ((castling & kingside) && mailbox[square + 3] == rook &&
+                !(occupied() & (squareBit(square + 1) | squareBit(square + 2))) && !isAttacked(square + 1, enemy) &&
+                !isAttacked(square + 2, enemy))
+                targets |= squareBit(square + 2);
+            if ((castling & queenside) && mailbox[square - 4] == rook &&
+                !(occupied() & (squareBit(square - 1) | squareBit(square - 2) | squareBit(square - 3))) &&
+                !isAttacked(square - 1, enemy) && !isAttacked(square - 2, enemy))
+                targets |= squareBit(square - 2);
+        }
+    }
+    return targets;
+}
+
+Bitboard BitBoard::legalTargets(int square) const {
+    uint8_t piece = mailbox[square];
+    if (piece == EMPTY_SQUARE) return 0;
+    return legalTargets(square, checkInfo(colorOf(piece)));
+}
+
+Bitboard BitBoard::legalTargets(int square, const CheckInfo &info) const {
+    uint8_t piece = mailbox[square];
+    if (piece == EMPTY_SQUARE) return 0;
+    Color color = colorOf(piece);
+    Color enemy = opposite(color);
+    Bitboard candidates = pseudoTargets(square);
+
+    if (typeOf(piece) == KING) {
+        // The king must not step along the ray of a slider it is currently blocking.
+        Bitboard withoutKing = occupied() ^ squareBit(square);
+        Bitboard legal = 0;
+        while (candidates) {
+            int to = popLsb(candidates);
+            if (!attackersTo(to, enemy, withoutKing)) legal |= squareBit(to);
+        }
+        return legal;
+    }
+
+    int king = kingSquare(color);
+    if (king == NO_SQUARE) return candidates;
+    if (info.pinned & squareBit(square)) candidates &= LINE[king][square];
+
+    Bitboard legal = candidates & info.evasions;
+    if (typeOf(piece) == PAWN && enPassant != NO_SQUARE && (candidates & squareBit(enPassant))) {
+        // En passant removes two pawns from the same rank, so check the resulting occupancy directly.
+        int captured = color == White ? enPassant - 8 : enPassant + 8;
+        Bitboard after = (occupied() ^ squareBit(square) ^ squareBit(captured)) | squareBit(enPassant);
+        Bitboard attackers = attackersTo(king, enemy, after) & ~squareBit(captured);
+        legal = (legal & ~squareBit(enPassant)) | (attackers ? 0 : squareBit(enPassant));
+    }
+    return legal;
+}
+
+Move BitBoard::encode(int from, int to, PieceType promotion) const {
+    uint8_t piece = mailbox[from];
+    int flags = mailbox[to] == EMPTY_SQUARE ? QUIET : CAPTURE;
+    if (typeOf(piece) == PAWN) {
+        int behind = colorOf(piece) == White ? to - 8 : to + 8;
+        if (to == enPassant && flags == QUIET && fileOf(to) != fileOf(from) &&
+            mailbox[behind] == makePiece(opposite(colorOf(piece)), PAWN))
+            flags = EN_PASSANT;
+        if (to - from == 16 || from - to == 16) flags = DOUBLE_PUSH;
+        if (rankOf(to) == 0 || rankOf(to) == 7) flags |= promotionFlags(promotion);
+    } else if (typeOf(piece) == KING && to - from == 2) {
+        flags = KING_CASTLE;
+    } else if (typeOf(piece) == KING && from - to == 2) {
+        flags = QUEEN_CASTLE;
+    }
+    return encodeMove(from, to, flags);
+}
+
+void BitBoard::addMoves(int from, Bitboard targets, MoveList &moves) const {
+    bool pawn = typeOf(mailbox[from]) == PAWN;
+    while (targets) {
+        int to = popLsb(targets);
+        if (pawn && (rankOf(to) == 0 || rankOf(to) == 7)) {
+            for (int promotion = QUEEN; promotion >= KNIGHT; --promotion)
+                moves.add(encode(from, to, static_cast<PieceType>(promotion)));
+        } else {
+            moves.add(encode(from, to));
+        }
+    }
+}
+
+void BitBoard::pseudoMoves(int square, MoveList &moves) const {
+    addMoves(square, pseudoTargets(square), moves);
+}
+
+void BitBoard::legalMoves(int square, const CheckInfo &info, MoveList &moves) const {
+    addMoves(square, legalTargets(square, info), moves);
+}
+
+void BitBoard::legalMoves(Color color, MoveList &moves) const {
+    CheckInfo info = checkInfo(color);
+    Bitboard own = colors[color];
+    // Only the king can move out of a double check.
+    if (popCount(info.checkers) > 1) own = bitboard(color, KING);
+    while (own) legalMoves(popLsb(own), info, moves);
+}
+
+void BitBoard::move(int from, int to, PieceType promotion) {
+    makeMove(encode(from, to, promotion));
+}
+
+void BitBoard::move(Move move) {
+    makeMove(move);
+}
+
+Undo BitBoard::makeMove(Move move) {
+    int from = moveFrom(move);
+    int to = moveTo(move);
+    int flags = moveFlags(move);
+    Undo undo{move, EMPTY_SQUARE, castling, enPassant, halfmoveClock};
+
+    uint8_t piece = remove(from);
+    Color color = colorOf(piece);
+    if (flags == EN_PASSANT)
+        undo.captured = remove(color == White ? to - 8 : to + 8);
+    else
+        undo.captured = remove(to);
+    put(isPromotion(move) ? makePiece(color, promotionType(move)) : piece, to);
+
+    if (flags == KING_CASTLE) put(remove(from + 3), from + 1);
+    if (flags == QUEEN_CASTLE) put(remove(from - 4), from - 1);
+
+    setCastling(castling & CASTLING_MASK[from] & CASTLING_MASK[to]);
+    setEnPassant(flags == DOUBLE_PUSH ? (from + to) / 2 : NO_SQUARE);
+    setSideToMove(opposite(color));
+    halfmoveClock = typeOf(piece) == PAWN || undo.captured != EMPTY_SQUARE ? 0 : halfmoveClock + 1;
+    if (color == Black) ++fullmoveNumber;
+    return undo;
+}
+
+void BitBoard::unmakeMove(const Undo &undo) {
+    int from = moveFrom(undo.move);
+    int to = moveTo(undo.move);
+    int flags = moveFlags(undo.move);
+
+    uint8_t piece = remove(to);
+    Color color = colorOf(piece);
+    put(isPromotion(undo.move) ? makePiece(color, PAWN) : piece, from);
+    if (undo.captured != EMPTY_SQUARE) put(undo.captured, flags == EN_PASSANT ? (color == White ? to - 8 : to + 8) : to);
+
+    if (flags == KING_CASTLE) put(remove(from + 1), from + 3);
+    if (flags == QUEEN_CASTLE) put(remove(from - 1), from - 4);
+
+    setCastling(undo.castling);
+    setEnPassant(undo.enPassant);
+    setSideToMove(color);
+    halfmoveClock = undo.halfmoveClock;
+    if (color == Black) --fullmoveNumber;
+}
@@ -0,0 +1,115 @@
+#ifndef BIT_BOARD_H
+#define BIT_BOARD_H
+
+#include <Constants.h>
+#include <MoveList.h>
+#include <array>
+#include <cstdint>
+#include <string>
+
+using Bitboard = uint64_t;
+
+// Squares are numbered a1 = 0 ... h8 = 63, the same order as the RFID readers.
+const uint8_t NO_SQUARE = 64;
+const uint8_t EMPTY_SQUARE = 0xFF;
+
+enum CastlingRights : uint8_t {
+    WHITE_KINGSIDE = 1,
+    WHITE_QUEENSIDE = 2,
+    BLACK_KINGSIDE = 4,
+    BLACK_QUEENSIDE = 8,
+    ALL_CASTLING = 15
+};
+
+constexpr Bitboard squareBit(int square) { return Bitboard(1) << square; }
+constexpr int fileOf(int square) { return square & 7; }
+constexpr int rankOf(int square) { return square >> 3; }
+constexpr Color opposite(Color color) { return color == White ? Black : White; }
+
+// A piece code indexes BitBoard::pieces: black pieces are 0-5, white pieces 6-11.
+constexpr uint8_t makePiece(Color color, PieceType type) { return color * 6 + type; }
+constexpr Color colorOf(uint8_t piece) { return piece < 6 ? Black : White; }
+constexpr PieceType typeOf(uint8_t piece) { return static_cast<PieceType>(piece % 6); }
+
+constexpr int lsb(Bitboard b) { return __builtin_ctzll(b); }
+inline int popLsb(Bitboard &b) {
+    int square = lsb(b);
+    b &= b - 1;
+    return square;
+}
+constexpr int popCount(Bitboard b) { return __builtin_popcountll(b); }
+
+// Check and pin state for one side, computed once per position and shared by every legal move query.
+struct CheckInfo {
+    Bitboard checkers = 0;
+    Bitboard pinned = 0;
+    Bitboard evasions = ~Bitboard(0); // squares a non-king move must land on
+};
+
+// Everything makeMove destroys, so unmakeMove can restore the position without a copy.
+struct Undo {
+    Move move;
+    uint8_t captured;
+    uint8_t castling;
+    uint8_t enPassant;
+    uint16_t halfmoveClock;
+};
+
+class BitBoard {
+public:
+    std::array<Bitboard, 12> pieces{};
+    std::array<Bitboard, 2> colors{};
+    std::array<uint8_t, 64> mailbox;
+    Color sideToMove = White;
+    uint8_t castling = 0;
+    uint8_t enPassant = NO_SQUARE;
+    uint16_t halfmoveClock = 0;  // plies since the last capture or pawn move, for the fifty-move rule
+    uint16_t fullmoveNumber = 1; // not part of the hash: the same position can arise at any move number
+    uint64_t key = 0; // Zobrist hash, kept up to date by every mutator below
+
+    BitBoard();
+    void clear();
+    void setInitial();
+    bool setFEN(const std::string &fen);
+    std::string toFEN() const;
+
+    void put(uint8_t piece, int square);
+    uint8_t remove(int square);
+    void setSideToMove(Color color);
+    void setCastling(uint8_t rights);
+    void dropCastlingRights(int square); // those a king or rook leaving or landing on square loses
+    void setEnPassant(uint8_t square);
+    uint64_t hash() const { return key; }
+    uint64_t computeHash() const;
+    uint8_t at(int square) const { return mailbox[square]; }
+    Bitboard occupied() const { return colors[Black] | colors[White]; }
+    Bitboard bitboard(Color color, PieceType type) const { return pieces[makePiece(color, type)]; }
+    int kingSquare(Color color) const;
+
+    Bitboard slidingAttacks(int square, int fileStep, int rankStep) const;
+    Bitboard rayAttacks(int square, int fileStep, int rankStep) const; // slidingAttacks via the magic tables
+    Bitboard attacks(int square) const;
+    Bitboard attackedBy(Color color) const;
+    Bitboard attackersTo(int square, Color color, Bitboard occupancy) const;
+    bool isAttacked(int square, Color color) const;
+    bool isCheck(Color color) const;
+    CheckInfo checkInfo(Color color) const;
+
+    Bitboard pseudoTargets(int square) const;
+    Bitboard legalTargets(int square) const;
+    Bitboard legalTargets(int square, const CheckInfo &info) const;
+    void pseudoMoves(int square, MoveList &moves) const;
+    void legalMoves(int square, const CheckInfo &info, MoveList &moves) const;
+    void legalMoves(Color color, MoveList &moves) const;
+
+    Move encode(int from, int to, PieceType promotion = QUEEN) const;
+    void move(int from, int to, PieceType promotion = QUEEN);
+    void move(Move move);
+    Undo makeMove(Move move);
+    void unmakeMove(const Undo &undo);
+
+private:
+    void addMoves(int from, Bitboard targets, MoveList &moves) const;
+};
+
+#endif
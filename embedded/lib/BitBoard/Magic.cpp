@@ -0,0 +1,112 @@
+#include "Magic.h"
+#include <cstddef>
+#include <utility>
+
+namespace {
+
+constexpr int ROOK_DIRECTIONS[4][2] = {{0, 1}, {0, -1}, {1, 0}, {-1, 0}};
+constexpr int BISHOP_DIRECTIONS[4][2] = {{1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+
+constexpr bool onBoard(int file, int rank) {
+    return file >= 0 && file < 8 && rank >= 0 && rank < 8;
+}
+
+// Walks each ray until it leaves the board or hits a blocker (the blocker is included).
+constexpr Bitboard rayAttacks(int square, Bitboard occupied, const int (*directions)[2]) {
+    Bitboard result = 0;
+    for (int d = 0; d < 4; ++d) {
+        int file = fileOf(square) + directions[d][0];
+        int rank = rankOf(square) + directions[d][1];
+        while (onBoard(file, rank)) {
+            result |= squareBit(rank * 8 + file);
+            if (occupied & squareBit(rank * 8 + file)) break;
+            file += directions[d][0];
+            rank += directions[d][1];
+        }
+    }
+    return result;
+}
+
+// Relevant occupancy: the rays without the edge squares, which never change the result.
+constexpr Bitboard relevantMask(int square, const int (*directions)[2]) {
+    Bitboard result = 0;
+    for (int d = 0; d < 4; ++d) {
+        int file = fileOf(square) + directions[d][0];
+        int rank = rankOf(square) + directions[d][1];
+        while (onBoard(file + directions[d][0], rank + directions[d][1])) {
+            result |= squareBit(rank * 8 + file);
+            file += directions[d][0];
+            rank += directions[d][1];
+        }
+    }
+    return result;
+}
+
+constexpr Bitboard ROOK_MAGIC_NUMBERS[64] = {
+    0x8080102040008000ULL, 0x5440041000200048ULL, 0x008020008010000aULL, 0x0200084200100420ULL,
+    0x0200081020040200ULL, 0x0600019002002824ULL, 0x040050811008020cULL, 0x0100004881000126ULL,
+    0x0005800440008020ULL, 0x2882002042090880ULL, 0x0002802000801004ULL, 0x0240808010000800ULL,
+    0x4480800800040082ULL, 0x0408808004000200ULL, 0x00ba0004a8020001ULL, 0x1106000042040091ULL,
+    0x0020208010400080ULL, 0x0022060045028020ULL, 0x0020008020100080ULL, 0x0202020008102041ULL,
+    0x0c50808008000400ULL, 0x0068808002000400ULL, 0x00510400c8100201ULL, 0x400006000100a444ULL,
+    0x483424818008400aULL, 0x8840008080200040ULL, 0x0800100080802000ULL, 0x0440100080800800ULL,
+    0x4000080080040080ULL, 0x9124040080020080ULL, 0x0089000300040e00ULL, 0x080001020020488cULL,
+    0x9040002040800080ULL, 0x80d0002001400242ULL, 0x0000401901002002ULL, 0x0030220901001000ULL,
+    0x0080580005003100ULL, 0x0022006c0a001008ULL, 0x0802301144001248ULL, 0x0020010042000084ULL,
+    0x4ac0400084228004ULL, 0x0010004020004000ULL, 0x3110004020010100ULL, 0x0598100009050020ULL,
+    0x4200080011010004ULL, 0x0818020004008080ULL, 0x02a0708102040008ULL, 0x5201010080420004ULL,
+    0x100b124063800100ULL, 0x7808200240048980ULL, 0x8800200010008080ULL, 0x1099201001000900ULL,
+    0x0100050010080100ULL, 0x0400800200040080ULL, 0x2040280190020400ULL, 0x00100c0100608200ULL,
+    0x0000201241088202ULL, 0x1040002042801b01ULL, 0x0124090010200041ULL, 0x0831002004081001ULL,
+    0x2003000800021005ULL, 0x80010002040008c1ULL, 0x0208008122081004ULL, 0x4000008844002102ULL};
+
+constexpr Bitboard BISHOP_MAGIC_NUMBERS[64] = {
+    0x0020011019010028ULL, 0x0122100912208000ULL, 0x1498082308200080ULL, 0x0004106600000000ULL,
+    0x2082021000405600ULL, 0x68508804c0820201ULL, 0xa004140422080010ULL, 0x0120402084202004ULL,
+    0x0000f0101014c080ULL, 0x014002300a022041ULL, 0x000084080a004020ULL, 0x2061949202010083ULL,
+    0x0407820210050008ULL, 0x00500101084008a2ULL, 0x2000040404420880ULL, 0x00090044041c0710ULL,
+    0x0804004030841140ULL, 0x002580a001240100ULL, 0x2081000214090200ULL, 0x0812022c01220050ULL,
+    0x0602001012100010ULL, 0x0003004080454024ULL, 0x0000400088084800ULL, 0x8000800040480850ULL,
+    0x1010040110602230ULL, 0x8428204002044d32ULL, 0x0340240028880200ULL, 0x1804080018220040ULL,
+    0x0c10101041004001ULL, 0x0422208008080100ULL, 0x0010810610941000ULL, 0x0302122002050140ULL,
+    0x8304104008054400ULL, 0x1000ac5003a45026ULL, 0x0202402080100508ULL, 0xc801042008040100ULL,
+    0x00400020210a0080ULL, 0x4010404200004104ULL, 0x0401180120008c00ULL, 0x0811450200110052ULL,
+    0xb10110825000a020ULL, 0x8104008405001050ULL, 0x0908094050030803ULL, 0x000414c204800804ULL,
+    0x2000202414004042ULL, 0x044001040020a100ULL, 0x0008100400440082ULL, 0x210101050a040102ULL,
+    0x8004442420080000ULL, 0x0906008421080000ULL, 0x0220208048081004ULL, 0x0000004084240800ULL,
+    0x00080020a0864200ULL, 0x40010484880e0000ULL, 0x9040100440808008ULL, 0x0010028089020002ULL,
+    0x100082004202c000ULL, 0x4049051042022000ULL, 0x010100010c110400ULL, 0x8200000b02208810ULL,
+    0x0000001008210100ULL, 0x0000180410241840ULL, 0x0880100401680a01ULL, 0x04021a0809040081ULL};
+
+template <int Square, bool Rook>
+constexpr auto buildSquareAttacks() {
+    const auto directions = Rook ? ROOK_DIRECTIONS : BISHOP_DIRECTIONS;
+    const Bitboard mask = relevantMask(Square, directions);
+    const Bitboard magic = Rook ? ROOK_MAGIC_NUMBERS[Square] : BISHOP_MAGIC_NUMBERS[Square];
+    constexpr int bits = popCount(relevantMask(Square, Rook ? ROOK_DIRECTIONS : BISHOP_DIRECTIONS));
+    std::array<Bitboard, std::size_t(1) << bits> table{};
+    // Carry-Rippler enumeration of every subset of the mask.
+    Bitboard subset = 0;
+    do {
+        table[(subset * magic) >> (64 - bits)] = rayAttacks(Square, subset, directions);
+        subset = (subset - mask) & mask;
+    } while (subset);
+    return table;
+}
+
+// One variable per square keeps each constexpr evaluation within the compiler's step limits.
+template <int Square, bool Rook>
+constexpr auto SQUARE_ATTACKS = buildSquareAttacks<Square, Rook>();
+
+template <bool Rook, std::size_t... Squares>
+constexpr std::array<Magic, 64> buildMagics(std::index_sequence<Squares...>) {
+    const auto directions = Rook ? ROOK_DIRECTIONS : BISHOP_DIRECTIONS;
+    const auto numbers = Rook ? ROOK_MAGIC_NUMBERS : BISHOP_MAGIC_NUMBERS;
+    return {{Magic{relevantMask(Squares, directions), numbers[Squares], SQUARE_ATTACKS<Squares, Rook>.data(),
+                   static_cast<uint8_t>(64 - popCount(relevantMask(Squares, directions)))}...}};
+}
+
+} // namespace
+
+constexpr std::array<Magic, 64> ROOK_MAGICS = buildMagics<true>(std::make_index_sequence<64>());
+constexpr std::array<Magic, 64> BISHOP_MAGICS = buildMagics<false>(std::make_index_sequence<64>());
@@ -0,0 +1,34 @@
+#ifndef MAGIC_H
+#define MAGIC_H
+
+#include <BitBoard.h>
+#include <array>
+#include <cstdint>
+
+// Fixed-shift magic bitboards. The tables are built by constexpr code in Magic.cpp, so they are
+// emitted as read-only data (flash on the ESP32) and nothing is computed at startup.
+struct Magic {
+    Bitboard mask;
+    Bitboard magic;
+    const Bitboard *attacks;
+    uint8_t shift;
+};
+
+extern const std::array<Magic, 64> ROOK_MAGICS;
+extern const std::array<Magic, 64> BISHOP_MAGICS;
+
+inline Bitboard rookAttacks(int square, Bitboard occupied) {
+    const Magic &m = ROOK_MAGICS[square];
+    return m.attacks[((occupied & m.mask) * m.magic) >> m.shift];
+}
+
+inline Bitboard bishopAttacks(int square, Bitboard occupied) {
+    const Magic &m = BISHOP_MAGICS[square];
+    return m.attacks[((occupied & m.mask) * m.magic) >> m.shift];
+}
+
+inline Bitboard queenAttacks(int square, Bitboard occupied) {
+    return rookAttacks(square, occupied) | bishopAttacks(square, occupied);
+}
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef MOVE_LIST_H
+#define MOVE_LIST_H
+
+#include <Constants.h>
+#include <array>
+#include <cstdint>
+#include <string>
+
+// A move packed into 16 bits: from in bits 0-5, to in bits 6-11 and MoveFlag in bits 12-15.
+using Move = uint16_t;
+
+const Move NO_MOVE = 0;
+
+enum MoveFlag : uint8_t {
+    QUIET = 0,
+    DOUBLE_PUSH = 1,
+    KING_CASTLE = 2,
+    QUEEN_CASTLE = 3,
+    CAPTURE = 4,
+    EN_PASSANT = 5,
+    PROMOTION = 8 // | CAPTURE for a capturing promotion, low two bits hold the piece (knight..queen)
+};
+
+constexpr Move encodeMove(int from, int to, int flags = QUIET) {
+    return static_cast<Move>(from | (to << 6) | (flags << 12));
+}
+constexpr int moveFrom(Move move) { return move & 0x3F; }
+constexpr int moveTo(Move move) { return (move >> 6) & 0x3F; }
+constexpr int moveFlags(Move move) { return move >> 12; }
+constexpr bool isCapture(Move move) { return moveFlags(move) & CAPTURE; }
+constexpr bool isPromotion(Move move) { return moveFlags(move) & PROMOTION; }
+constexpr PieceType promotionType(Move move) {
+    return isPromotion(move) ? static_cast<PieceType>(KNIGHT + (moveFlags(move) & 3)) : QUEEN;
+}
+constexpr int promotionFlags(PieceType type) { return PROMOTION | (type - KNIGHT); }
+
+// Long algebraic notation as used by UCI engines, e.g. "e2e4" or "e7e8q".
+inline std::string moveToUci(Move move) {
+    std::string uci = {char('a' + moveFrom(move) % 8), char('1' + moveFrom(move) / 8),
+                       char('a' + moveTo(move) % 8), char('1' + moveTo(move) / 8)};
+    if (isPromotion(move)) uci += "nbrq"[promotionType(move) - KNIGHT];
+    return uci;
+}
+
+// Fixed-capacity list that lives on the stack; 256 covers the 218 legal moves of the worst known position.
+class MoveList {
+public:
+    static const int CAPACITY = 256;
+
+    void add(Move move) { moves[count++] = move; }
+    void clear() { count = 0; }
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    Move operator[](int i) const { return moves[i]; }
+    const Move *begin() const { return moves.data(); }
+    const Move *end() const { return moves.data() + count; }
+    Move *begin() { return moves.data(); }
+    Move *end() { return moves.data() + count; }
+
+    bool contains(Move move) const {
+        for (Move m : *this)
+            if (m == move) return true;
+        return false;
+    }
+
+private:
+    std::array<Move, CAPACITY> moves;
+    int count = 0;
+};
+
+#endif
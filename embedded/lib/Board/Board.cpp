@@ -9,55 +9,100 @@
 #include <optional>
 #include <unordered_map>
 #include <unordered_set>
-using PieceFactory = std::function<std::shared_ptr<Piece>(Color, Index)>;
-std::vector<PieceFactory> piecesInOrder = {
-    [](Color c, Index i) { return std::make_shared<Castle>(c, i); },
-    [](Color c, Index i) { return std::make_shared<Knight>(c, i); },
-    [](Color c, Index i) { return std::make_shared<Bishop>(c, i); },
-    [](Color c, Index i) { return std::make_shared<Queen>(c, i); },
-    [](Color c, Index i) { return std::make_shared<King>(c, i); },
-    [](Color c, Index i) { return std::make_shared<Bishop>(c, i); },
-    [](Color c, Index i) { return std::make_shared<Knight>(c, i); },
-    [](Color c, Index i) { return std::make_shared<Castle>(c, i); }};
+
+static int toSquare(const XYPos &xyPos) {
+    return (xyPos.y - MIN_RANK) * 8 + (static_cast<int>(xyPos.x) - MIN_FILE);
+}
+
+static XYPos toXYPos(int square) {
+    return XYPos(fileOf(square) + MIN_FILE, rankOf(square) + MIN_RANK);
+}
+
+static std::unordered_set<XYPos> toPositions(Bitboard squares) {
+    std::unordered_set<XYPos> positions;
+    while (squares) positions.insert(toXYPos(popLsb(squares)));
+    return positions;
+}
 
 Board::Board() {
-    const std::vector ranks = {1, 2, 7, 8};
-    for (int x = MIN_FILE; x <= MAX_FILE; ++x) {
-        for (int y : ranks) {
-            auto xyPos = XYPos(x, y);
-            Index file = static_cast<Index>(x);
-            std::shared_ptr<Piece> piece;
-            if (y == 1)
-                piece = piecesInOrder[x - 1](White, file);
-            else if (y == 2)
-                piece = std::make_shared<Pawn>(White, file);
-            else if (y == 7)
-                piece = std::make_shared<Pawn>(Black, file);
-            else if (y == 8)
-                piece = piecesInOrder[x - 1](Black, file);
-            if (piece) addToBoard(piece, xyPos);
-            if (piece && piece->name == "King") {
-                if (piece->color == White)
-                    whiteKing = std::dynamic_pointer_cast<King>(piece);
-                else
-                    blackKing = std::dynamic_pointer_cast<King>(piece);
-            }
+    engine.setInitial();
+    loadPieces();
+}
+
+Board::Board(const BitBoard &position) : engine(position) {
+    loadPieces();
+}
+
+std::optional<Board> Board::fromFEN(const std::string &fen) {
+    BitBoard position;
+    if (!position.setFEN(fen)) return std::nullopt;
+    return Board(position);
+}
+
+std::string Board::toFEN() const {
+    return engine.toFEN();
+}
+
+// Creates a Piece handle for every occupied square of the engine. The moved flags are inferred from the
+// position, since they decide which steps Piece::movements() offers.
+void Board::loadPieces() {
+    pieceToCoordinate.reserve(32);
+    coordinateToPiece.reserve(32);
+    Bitboard occupied = engine.occupied();
+    while (occupied) {
+        int square = popLsb(occupied);
+        uint8_t code = engine.at(square);
+        XYPos xyPos = toXYPos(square);
+        auto piece = createPiece(colorOf(code), static_cast<Index>(xyPos.x), typeOf(code));
+        Color color = piece->color;
+        int home = color == White ? 0 : 56;
+        uint8_t kingside = color == White ? WHITE_KINGSIDE : BLACK_KINGSIDE;
+        uint8_t queenside = color == White ? WHITE_QUEENSIDE : BLACK_QUEENSIDE;
+        if (piece->type == PAWN)
+            piece->moved = rankOf(square) != (color == White ? 1 : 6);
+        else if (piece->type == KING)
+            piece->moved = !(engine.castling & (kingside | queenside));
+        else if (piece->type == ROOK)
+            piece->moved = !((square == home + 7 && (engine.castling & kingside)) ||
+                             (square == home && (engine.castling & queenside)));
+        else
+            piece->moved = rankOf(square) != rankOf(home);
+        piece->movedTwice = piece->type == PAWN && engine.enPassant != NO_SQUARE &&
+                            square == engine.enPassant + (color == White ? 8 : -8);
+        placeInMaps(piece, xyPos);
+        if (piece->type == KING) {
+            if (color == White)
+                whiteKing = std::static_pointer_cast<King>(piece);
+            else
+                blackKing = std::static_pointer_cast<King>(piece);
         }
     }
 }
 
-void Board::addToBoard(std::shared_ptr<Piece> p, XYPos &xyPos) {
-    pieceToCoordinate[p] = xyPos;
-    coordinateToPiece[xyPos] = p;
+void Board::placeInMaps(const std::shared_ptr<Piece> &piece, const XYPos &xyPos) {
+    pieceToCoordinate[piece] = xyPos;
+    coordinateToPiece[xyPos] = piece;
 }
 
-void Board::updatePiece(std::shared_ptr<Piece> piece, XYPos &newPosition) {
+void Board::eraseFromMaps(const XYPos &xyPos) {
+    if (!coordinateToPiece.count(xyPos)) return;
+    pieceToCoordinate.erase(coordinateToPiece[xyPos]);
+    coordinateToPiece.erase(xyPos);
+}
+
+void Board::addToBoard(const std::shared_ptr<Piece> &p, XYPos &xyPos) {
+    placeInMaps(p, xyPos);
+    engine.remove(toSquare(xyPos));
+    engine.put(makePiece(p->color, p->type), toSquare(xyPos));
+    engine.dropCastlingRights(toSquare(xyPos));
+}
+
+void Board::updatePiece(const std::shared_ptr<Piece> &piece, XYPos &newPosition) {
     XYPos originalPosition = pieceToCoordinate[piece];
-    if (coordinateToPiece.count(newPosition)) {
-        auto captured = coordinateToPiece[newPosition];
-        pieceToCoordinate.erase(captured);
-    }
+    eraseFromMaps(newPosition);
     coordinateToPiece.erase(originalPosition);
+    engine.remove(toSquare(originalPosition));
+    engine.dropCastlingRights(toSquare(originalPosition));
     addToBoard(piece, newPosition);
 }
 
@@ -75,139 +120,125 @@ std::optional<std::shared_ptr<Piece>> Board::getPiece(const XYPos &xyPos) const
 }
 
 std::unordered_set<XYPos> Board::slidingMoves(XYPos &currentPosition, const XYPos &moveVector) {
-    auto piece = coordinateToPiece[currentPosition];
-    std::unordered_set<XYPos> moves;
-    for (int k = MIN_RANK; k < MAX_RANK; ++k) {
-        XYPos potential = currentPosition + (k * moveVector);
-        if (!isValidPosition(potential)) return moves;
-        if (coordinateToPiece.count(potential) == 0)
-            moves.insert(potential);
-        else if (coordinateToPiece[potential]->color != piece->color) {
-            moves.insert(potential);
-            return moves;
-        } else
-            return moves;
-    }
-    return moves;
+    int square = toSquare(currentPosition);
+    uint8_t piece = engine.at(square);
+    if (piece == EMPTY_SQUARE) return {};
+    Bitboard ray = engine.rayAttacks(square, static_cast<int>(moveVector.x), moveVector.y);
+    return toPositions(ray & ~engine.colors[colorOf(piece)]);
 }
 
-std::unordered_set<XYPos> Board::pseudoMoves(std::shared_ptr<Piece> piece) {
-    std::unordered_set<XYPos> moves;
-    XYPos current = pieceToCoordinate[piece];
+std::unordered_set<XYPos> Board::pseudoMoves(const std::shared_ptr<Piece> &piece) {
+    return toPositions(engine.pseudoTargets(toSquare(pieceToCoordinate[piece])));
+}
 
-    if (piece->slidingPiece()) {
-        for (auto move : piece->movements()) {
-            XYPos mv(move);
-            auto set1 = slidingMoves(current, mv);
-            auto set2 = slidingMoves(current, mv * -1);
-            moves.insert(set1.begin(), set1.end());
-            moves.insert(set2.begin(), set2.end());
-        }
-    } else {
-        for (auto move : piece->movements()) {
-            XYPos mv(move);
-            XYPos potential = current + mv;
-            if (!isValidPosition(potential)) continue; // out of bounds
-            auto atPot = getPiece(potential);
-
-            if (piece->name == "Pawn") {
-                std::shared_ptr<Pawn> pawn = std::dynamic_pointer_cast<Pawn>(piece);
-                bool isWhite = piece->color == Color::White;
-                if ((isWhite && (move == std::array<int, 2>{1, 1} || move == std::array<int, 2>{-1, 1})) ||
-                    (!isWhite && (move == std::array<int, 2>{1, -1} || move == std::array<int, 2>{-1, -1}))) {
-                    XYPos enPassant = isWhite ? XYPos(potential.x, potential.y - 1) : XYPos(potential.x, potential.y + 1);
-                    auto atEnPassant = getPiece(enPassant);
-                    if ((atPot && atPot.value()->color != piece->color) ||
-                        (!atPot && atEnPassant && atEnPassant.value()->name == "Pawn" &&
-                         std::dynamic_pointer_cast<Pawn>(atEnPassant.value())->movedTwice &&
-                         atEnPassant.value()->color != piece->color)) {
-                        moves.insert(potential);
-                    }
-                    continue;
-                }
-            }
-            if (piece->name == "King" && (move == std::array<int, 2>{-2, 0} || move == std::array<int, 2>{2, 0})) {
-                int rank = piece->color == Color::White ? MIN_RANK : MAX_RANK;
-                if (move[0] == -2) {
-                    if (!getPiece(XYPos(Index::d, rank)) && !getPiece(XYPos(Index::c, rank)) &&
-                        !getPiece(XYPos(Index::b, rank)) && getPiece(XYPos(Index::a, rank))) {
-                        auto rook = getPiece(XYPos(Index::a, rank)).value();
-                        if (rook->name == "Castle" && !rook->hasMoved()) moves.insert(potential);
-                    }
-                } else {
-                    if (!getPiece(XYPos(Index::f, rank)) && !getPiece(XYPos(Index::g, rank)) &&
-                        getPiece(XYPos(Index::h, rank))) {
-                        auto rook = getPiece(XYPos(Index::h, rank)).value();
-                        if (rook->name == "Castle" && !rook->hasMoved()) moves.insert(potential);
-                    }
-                }
-                continue;
-            }
-            if (piece->name == "Pawn") {
-                int dir = (piece->color == Color::White) ? 1 : -1;
-                int startRow = (piece->color == Color::White) ? 2 : 7;
-
-                // One step forward
-                if (move == std::array<int, 2>{0, dir} && !atPot) {
-                    moves.insert(potential);
-                }
-
-                // Two steps forward from starting rank, only if both squares are empty
-                if (move == std::array<int, 2>{0, 2 * dir} && current.y == startRow) {
-                    XYPos intermediate = current + XYPos(0, dir);
-                    if (!getPiece(intermediate).has_value() && !atPot) {
-                        moves.insert(potential);
-                    }
-                }
-            } else {
-                // for all other pieces
-                if (!atPot || atPot.value()->color != piece->color) {
-                    moves.insert(potential);
-                }
-            }
-        }
-    }
-    return moves;
+uint64_t Board::hash() const {
+    return engine.hash();
 }
 
 bool Board::isCheck(Color color) {
-    XYPos kingPos = getKingPosition(color);
-    for (auto &[p, _] : pieceToCoordinate) {
-        if (p->color != color && pseudoMoves(p).count(kingPos)) {
-            return true;
-        }
-    }
-    return false;
+    return engine.isCheck(color);
 }
 
-bool Board::isKingExposed(std::shared_ptr<Piece> piece, XYPos &potential) {
-    auto original = pieceToCoordinate[piece];
-    auto prevPiece = getPiece(potential);
-    updatePiece(piece, potential);
-    bool exposed = isCheck(piece->color);
-    updatePiece(piece, original);
-    if (prevPiece) addToBoard(prevPiece.value(), potential);
+bool Board::isKingExposed(const std::shared_ptr<Piece> &piece, XYPos &potential) {
+    Undo undo = engine.makeMove(engine.encode(toSquare(pieceToCoordinate[piece]), toSquare(potential)));
+    bool exposed = engine.isCheck(piece->color);
+    engine.unmakeMove(undo);
     return exposed;
 }
 
-std::unordered_set<XYPos> Board::getValidMoves(std::shared_ptr<Piece> piece) {
-    std::unordered_set<XYPos> result;
-    for (auto move : pseudoMoves(piece)) {
-        if (!isKingExposed(piece, move)) result.insert(move);
+std::unordered_set<XYPos> Board::getValidMoves(const std::shared_ptr<Piece> &piece) {
+    return toPositions(engine.legalTargets(toSquare(pieceToCoordinate[piece])));
+}
+
+void Board::pseudoMoves(const std::shared_ptr<Piece> &piece, MoveList &moves) {
+    engine.pseudoMoves(toSquare(pieceToCoordinate[piece]), moves);
+}
+
+void Board::getValidMoves(const std::shared_ptr<Piece> &piece, MoveList &moves) {
+    int square = toSquare(pieceToCoordinate[piece]);
+    engine.legalMoves(square, engine.checkInfo(piece->color), moves);
+}
+
+void Board::getValidMoves(Color color, MoveList &moves) {
+    engine.legalMoves(color, moves);
+}
+
+void Board::movePiece(const std::shared_ptr<Piece> &piece, XYPos &dest) {
+    MoveList moves;
+    getValidMoves(piece, moves);
+    // The first move to a promotion square is the queen promotion.
+    for (Move move : moves) {
+        if (moveTo(move) == toSquare(dest)) {
+            makeMove(move);
+            return;
+        }
     }
-    return result;
 }
 
-void Board::movePiece(std::shared_ptr<Piece> piece, XYPos &dest) {
-    if (!getValidMoves(piece).count(dest)) return;
-    XYPos origin = pieceToCoordinate[piece];
-    XYPos delta = dest - origin;
+void Board::movePiece(Move move) {
+    auto piece = getPiece(toXYPos(moveFrom(move)));
+    if (!piece) return;
+    MoveList moves;
+    getValidMoves(piece.value(), moves);
+    if (moves.contains(move)) makeMove(move);
+}
+
+void Board::makeMove(Move move) {
+    XYPos origin = toXYPos(moveFrom(move));
+    XYPos dest = toXYPos(moveTo(move));
+    auto piece = coordinateToPiece[origin];
+    int flags = moveFlags(move);
+    XYPos capturedAt = flags == EN_PASSANT ? XYPos(dest.x, origin.y) : dest;
+
+    BoardUndo record{engine.makeMove(move), piece, nullptr, piece->moved, piece->movedTwice};
+    if (auto captured = getPiece(capturedAt)) record.captured = captured.value();
+    history.push_back(record);
+
     piece->moved = true;
-    if (piece->name == "Pawn") {
-        if (std::abs(delta.y) == 2)
-            std::dynamic_pointer_cast<Pawn>(piece)->movedTwice = true;
-        else
-            std::dynamic_pointer_cast<Pawn>(piece)->movedTwice = false;
+    piece->movedTwice = flags == DOUBLE_PUSH;
+    eraseFromMaps(capturedAt);
+    coordinateToPiece.erase(origin);
+    placeInMaps(piece, dest);
+
+    if (isPromotion(move)) {
+        auto promoted = createPiece(piece->color, piece->index, promotionType(move));
+        promoted->moved = true;
+        eraseFromMaps(dest);
+        placeInMaps(promoted, dest);
+    }
+    if (flags == KING_CASTLE || flags == QUEEN_CASTLE) {
+        XYPos rookOrigin(flags == KING_CASTLE ? Index::h : Index::a, origin.y);
+        XYPos rookDest(flags == KING_CASTLE ? Index::f : Index::d, origin.y);
+        auto rook = coordinateToPiece[rookOrigin];
+        rook->moved = true;
+        coordinateToPiece.erase(rookOrigin);
+        placeInMaps(rook, rookDest);
+    }
+}
+
+void Board::unmakeMove() {
+    if (history.empty()) return;
+    BoardUndo record = history.back();
+    history.pop_back();
+    Move move = record.undo.move;
+    XYPos origin = toXYPos(moveFrom(move));
+    XYPos dest = toXYPos(moveTo(move));
+    int flags = moveFlags(move);
+    engine.unmakeMove(record.undo);
+
+    eraseFromMaps(dest);
+    placeInMaps(record.mover, origin);
+    record.mover->moved = record.moved;
+    record.mover->movedTwice = record.movedTwice;
+    if (record.captured) placeInMaps(record.captured, flags == EN_PASSANT ? XYPos(dest.x, origin.y) : dest);
+
+    if (flags == KING_CASTLE || flags == QUEEN_CASTLE) {
+        // Castling rights guarantee the rook had not moved before.
+        XYPos rookOrigin(flags == KING_CASTLE ? Index::h : Index::a, origin.y);
+        XYPos rookDest(flags == KING_CASTLE ? Index::f : Index::d, origin.y);
+        auto rook = coordinateToPiece[rookDest];
+        rook->moved = false;
+        coordinateToPiece.erase(rookDest);
+        placeInMaps(rook, rookOrigin);
     }
-    updatePiece(piece, dest);
 }
@@ -1,37 +1,67 @@
 #ifndef BOARD_H
 #define BOARD_H
 
+#include <BitBoard.h>
 #include <Constants.h>
+#include <MoveList.h>
 #include <Piece.h>
 #include <XYPos.h>
 #include <iostream>
 #include <optional>
 #include <set>
+#include <string>
 #include <unordered_map>
 #include <memory> 
 #include <unordered_set>
+#include <vector>
+
+// Undo record for Board::makeMove: the engine state plus the Piece objects and flags the move changed.
+struct BoardUndo {
+    Undo undo;
+    std::shared_ptr<Piece> mover;
+    std::shared_ptr<Piece> captured;
+    bool moved;
+    bool movedTwice;
+};
 
 class Board {
 public:
     Board();
+    static std::optional<Board> fromFEN(const std::string &fen);
+    std::string toFEN() const;
+    BitBoard engine;
     std::shared_ptr<King> whiteKing;
     std::shared_ptr<King> blackKing;
     XYPos getKingPosition(Color color);
     bool isValidPosition(XYPos &xyPos);
-    void addToBoard(std::shared_ptr<Piece> p, XYPos &xyPos);
+    void addToBoard(const std::shared_ptr<Piece> &p, XYPos &xyPos);
     std::unordered_map<std::shared_ptr<Piece>, XYPos> pieceToCoordinate = {};
     std::unordered_map<XYPos, std::shared_ptr<Piece>> coordinateToPiece = {};
 
     std::unordered_set<XYPos> slidingMoves(XYPos &currentPosition, const XYPos &moveVector);
 
-    std::unordered_set<XYPos> pseudoMoves(std::shared_ptr<Piece> piece);
-    void updatePiece(std::shared_ptr<Piece> piece, XYPos &newPosition);
+    std::unordered_set<XYPos> pseudoMoves(const std::shared_ptr<Piece> &piece);
+    void pseudoMoves(const std::shared_ptr<Piece> &piece, MoveList &moves);
+    void updatePiece(const std::shared_ptr<Piece> &piece, XYPos &newPosition);
     bool isCheck(Color color);
-    bool isKingExposed(std::shared_ptr<Piece> piece, XYPos &potential);
+    uint64_t hash() const;
+    bool isKingExposed(const std::shared_ptr<Piece> &piece, XYPos &potential);
 
-    std::unordered_set<XYPos> getValidMoves(std::shared_ptr<Piece> piece);
-    void movePiece(std::shared_ptr<Piece> piece, XYPos &finalPosition);
+    std::unordered_set<XYPos> getValidMoves(const std::shared_ptr<Piece> &piece);
+    void getValidMoves(const std::shared_ptr<Piece> &piece, MoveList &moves);
+    void getValidMoves(Color color, MoveList &moves);
+    void movePiece(const std::shared_ptr<Piece> &piece, XYPos &finalPosition);
+    void movePiece(Move move);
+    void makeMove(Move move);
+    void unmakeMove();
+    std::vector<BoardUndo> history;
     std::optional<std::shared_ptr<Piece>> getPiece(const XYPos &xyPos) const;
+
+private:
+    explicit Board(const BitBoard &position);
+    void loadPieces();
+    void placeInMaps(const std::shared_ptr<Piece> &piece, const XYPos &xyPos);
+    void eraseFromMaps(const XYPos &xyPos);
 };
 
 #endif
\ No newline at end of file
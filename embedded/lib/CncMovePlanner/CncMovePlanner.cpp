@@ -0,0 +1,137 @@
+#include "CncMovePlanner.h"
+#include <cmath>
+
+namespace {
+
+float distance(Waypoint a, Waypoint b) { return std::hypot(a.x - b.x, a.y - b.y); }
+
+// Appends a point, dropping the previous one when it lies on a straight line between its neighbours.
+void extend(std::vector<Waypoint> &path, Waypoint point) {
+    size_t n = path.size();
+    if (n >= 2) {
+        Waypoint a = path[n - 2], b = path[n - 1];
+        if ((b.x - a.x) * (point.y - a.y) == (b.y - a.y) * (point.x - a.x)) path.pop_back();
+    }
+    path.push_back(point);
+}
+
+// Travel to each leg with the magnet off plus the carried distance, starting from the gantry.
+float cost(const std::vector<CncLeg> &legs, Waypoint gantry) {
+    float total = 0;
+    for (const CncLeg &leg : legs) {
+        total += distance(gantry, leg.path.front()) + PathPlanner::length(leg.path);
+        gantry = leg.path.back();
+    }
+    return total;
+}
+
+CncLeg carry(const BitBoard &position, int from, int to, Bitboard occupied) {
+    return {PathPlanner::route(from, to, occupied), position.at(from), occupied & ~squareBit(from) & ~squareBit(to)};
+}
+
+} // namespace
+
+void CncMovePlanner::clear() {
+    for (auto &slots : graveyard) slots.fill(EMPTY_SQUARE);
+}
+
+Waypoint CncMovePlanner::slotCenter(Color color, int slot) {
+    int file = 8 + (color == White ? 0 : 2) + slot / 8;
+    return {file * PathPlanner::SQUARE_MM + PathPlanner::SQUARE_MM / 2, (slot % 8) * PathPlanner::SQUARE_MM + PathPlanner::SQUARE_MM / 2};
+}
+
+int CncMovePlanner::freeSlot(Color color, int square) const {
+    int best = -1;
+    for (int slot = 0; slot < GRAVEYARD_SLOTS; ++slot) {
+        if (graveyard[color][slot] != EMPTY_SQUARE) continue;
+        if (best < 0 || distance(PathPlanner::squareCenter(square), slotCenter(color, slot)) <
+                            distance(PathPlanner::squareCenter(square), slotCenter(color, best)))
+            best = slot;
+    }
+    return best;
+}
+
+// Leaves the board at the right-hand edge on one of the two lanes bordering the slot's rank, follows that
+// lane between the parked pieces and steps up or down into the slot.
+CncLeg CncMovePlanner::toSlot(int square, uint8_t piece, int slot, Bitboard occupied) const {
+    Waypoint target = slotCenter(colorOf(piece), slot);
+    GridPoint start{fileOf(square) * 2 + 1, rankOf(square) * 2 + 1};
+    CncLeg best{{}, piece, occupied & ~squareBit(square)};
+    for (int lane : {slot % 8 * 2, slot % 8 * 2 + 2}) {
+        std::vector<Waypoint> path = PathPlanner::route(start, GridPoint{16, lane}, occupied & ~squareBit(square));
+        if (path.empty()) continue;
+        extend(path, {target.x, lane * PathPlanner::SQUARE_MM / 2});
+        extend(path, target);
+        if (best.path.empty() || PathPlanner::length(path) < PathPlanner::length(best.path)) best.path = path;
+    }
+    return best;
+}
+
+std::vector<CncLeg> CncMovePlanner::plan(const BitBoard &position, Move move, Waypoint gantry) {
+    int from = moveFrom(move), to = moveTo(move), flags = moveFlags(move);
+    uint8_t piece = position.at(from);
+    Color us = colorOf(piece), them = opposite(us);
+    Bitboard occupied = position.occupied();
+    std::vector<CncLeg> legs;
+
+    if (flags == KING_CASTLE || flags == QUEEN_CASTLE) {
+        int rookFrom = flags == KING_CASTLE ? from + 3 : from - 4;
+        int rookTo = flags == KING_CASTLE ? from + 1 : from - 1;
+        Bitboard kingMoved = occupied ^ squareBit(from) ^ squareBit(to);
+        Bitboard rookMoved = occupied ^ squareBit(rookFrom) ^ squareBit(rookTo);
+        std::vector<CncLeg> kingFirst = {carry(position, from, to, occupied), carry(position, rookFrom, rookTo, kingMoved)};
+        std::vector<CncLeg> rookFirst = {carry(position, rookFrom, rookTo, occupied), carry(position, from, to, rookMoved)};
+        return cost(kingFirst, gantry) <= cost(rookFirst, gantry) ? kingFirst : rookFirst;
+    }
+
+    if (flags == EN_PASSANT) {
+        int victim = us == White ? to - 8 : to + 8;
+        int slot = freeSlot(them, victim);
+        Bitboard pawnMoved = occupied ^ squareBit(from) ^ squareBit(to);
+        std::vector<CncLeg> victimFirst = {toSlot(victim, position.at(victim), slot, occupied),
+                                           carry(position, from, to, occupied ^ squareBit(victim))};
+        std::vector<CncLeg> pawnFirst = {carry(position, from, to, occupied), toSlot(victim, position.at(victim), slot, pawnMoved)};
+        graveyard[them][slot] = position.at(victim);
+        return cost(victimFirst, gantry) <= cost(pawnFirst, gantry) ? victimFirst : pawnFirst;
+    }
+
+    if (isCapture(move)) {
+        // The target square has to be cleared before anything can land on it.
+        int slot = freeSlot(them, to);
+        legs.push_back(toSlot(to, position.at(to), slot, occupied));
+        graveyard[them][slot] = position.at(to);
+        occupied ^= squareBit(to);
+    }
+
+    if (isPromotion(move) && swapPromotions) {
+        uint8_t promoted = makePiece(us, promotionType(move));
+        for (int replacement = 0; replacement < GRAVEYARD_SLOTS; ++replacement) {
+            if (graveyard[us][replacement] != promoted) continue;
+            // Park the pawn, then bring the captured piece back in on the promotion square.
+            int slot = freeSlot(us, from);
+            legs.push_back(toSlot(from, piece, slot, occupied));
+            graveyard[us][slot] = piece;
+            CncLeg back = toSlot(to, promoted, replacement, occupied ^ squareBit(from));
+            legs.push_back({{back.path.rbegin(), back.path.rend()}, promoted, back.others});
+            graveyard[us][replacement] = EMPTY_SQUARE;
+            return legs;
+        }
+        // Nothing to swap in: the pawn stands in for the new piece.
+    }
+
+    legs.push_back(carry(position, from, to, occupied));
+    return legs;
+}
+
+Move CncMovePlanner::inferMove(const BitBoard &position, int from, int to, PieceType promotion) {
+    uint8_t piece = position.at(from);
+    bool capture = position.at(to) != EMPTY_SQUARE;
+    if (typeOf(piece) == KING && std::abs(fileOf(to) - fileOf(from)) == 2)
+        return encodeMove(from, to, to > from ? KING_CASTLE : QUEEN_CASTLE);
+    if (typeOf(piece) == PAWN) {
+        if (fileOf(to) != fileOf(from) && !capture) return encodeMove(from, to, EN_PASSANT);
+        if (rankOf(to) == 0 || rankOf(to) == 7) return encodeMove(from, to, promotionFlags(promotion) | (capture ? CAPTURE : 0));
+        if (std::abs(to - from) == 16) return encodeMove(from, to, DOUBLE_PUSH);
+    }
+    return encodeMove(from, to, capture ? CAPTURE : QUIET);
+}
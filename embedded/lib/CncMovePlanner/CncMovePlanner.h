@@ -0,0 +1,53 @@
+#ifndef CNC_MOVE_PLANNER_H
+#define CNC_MOVE_PLANNER_H
+
+#include <BitBoard.h>
+#include <MoveList.h>
+#include <PathPlanner.h>
+#include <array>
+#include <vector>
+
+// One pick-and-place: travel to path.front() with the magnet off, engage, follow path, release.
+struct CncLeg {
+    std::vector<Waypoint> path;
+    uint8_t piece = EMPTY_SQUARE; // what is being carried
+    Bitboard others = 0;          // the pieces left on the board while it is
+};
+
+// Turns a chess move into the legs that play it on the physical board: captured pieces go to the graveyard
+// first, the rook follows the king when castling, and, with swapPromotions set, a promoting pawn is swapped
+// for a captured piece of the chosen type when the graveyard has one. Where two legs could go in either order (castling, en
+// passant) the one with less total travel wins.
+//
+// The graveyard lies beyond the h-file: files i and j hold captured white pieces, k and l black ones,
+// eight slots to a file. The planner remembers what it parked where, so plan() must be called once for
+// every move that is played, and clear() when the pieces are set up again.
+class CncMovePlanner {
+public:
+    static constexpr int GRAVEYARD_SLOTS = 16; // a side can lose at most 15 pieces
+
+    CncMovePlanner() { clear(); }
+    void clear();
+
+    std::vector<CncLeg> plan(const BitBoard &position, Move move, Waypoint gantry);
+
+    // Flags for a from-to move read off the board alone: two king files is a castle, a pawn moving
+    // diagonally to an empty square captures en passant, and a pawn on the last rank promotes.
+    static Move inferMove(const BitBoard &position, int from, int to, PieceType promotion = QUEEN);
+
+    static Waypoint slotCenter(Color color, int slot);
+    uint8_t slotPiece(Color color, int slot) const { return graveyard[color][slot]; }
+
+    // Off, the promoting pawn itself goes to the square and stands in for the new piece. Only turn it on
+    // where the caller can follow the swap: the piece that comes back carries a different RFID tag.
+    bool swapPromotions = false;
+
+private:
+    int freeSlot(Color color, int square) const; // the empty slot nearest to square
+    // Carries the piece on square off the board into a slot; reversed, it brings a piece back.
+    CncLeg toSlot(int square, uint8_t piece, int slot, Bitboard occupied) const;
+
+    std::array<std::array<uint8_t, GRAVEYARD_SLOTS>, 2> graveyard;
+};
+
+#endif
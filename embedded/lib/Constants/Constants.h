@@ -1,5 +1,21 @@
 #ifndef FYP_CONSTANTS_H
 #define FYP_CONSTANTS_H
+#include <cstdint>
+
 const int MIN_RANK = 1, MIN_FILE = 1;
 const int MAX_RANK = 8, MAX_FILE = 8;
-#endif 
\ No newline at end of file
+
+enum Color {
+    Black,
+    White
+};
+
+enum PieceType : uint8_t {
+    PAWN,
+    KNIGHT,
+    BISHOP,
+    ROOK,
+    QUEEN,
+    KING
+};
+#endif 
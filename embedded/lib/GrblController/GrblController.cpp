@@ -0,0 +1,147 @@
+#include "GrblController.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+GrblController::GrblController(GrblLink &link) : link(link) {}
+
+void GrblController::send(const std::string &program) {
+    size_t start = 0;
+    while (start < program.size()) {
+        size_t end = program.find('\n', start);
+        if (end == std::string::npos) end = program.size();
+        if (end > start) queued.push_back(program.substr(start, end - start));
+        start = end + 1;
+    }
+    statusSinceDrain = false;
+}
+
+void GrblController::moveTo(float x, float y, int feedRate) {
+    char line[48];
+    if (feedRate > 0) {
+        snprintf(line, sizeof(line), "G1 X%.2f Y%.2f F%d", x, y, feedRate);
+    } else {
+        snprintf(line, sizeof(line), "G0 X%.2f Y%.2f", x, y);
+    }
+    send(line);
+}
+
+void GrblController::setAcceleration(int mmPerSec2) {
+    if (mmPerSec2 == acceleration) return;
+    acceleration = mmPerSec2;
+    send("$120=" + std::to_string(mmPerSec2) + "\n$121=" + std::to_string(mmPerSec2));
+}
+
+void GrblController::onIdle(std::function<void()> callback) {
+    idleCallbacks.push_back(std::move(callback));
+}
+
+void GrblController::clear() {
+    for (const std::string &line : queued) {
+        if (line[0] == '$') acceleration = 0; // a dropped $120/$121 never took effect
+    }
+    queued.clear();
+    idleCallbacks.clear();
+}
+
+bool GrblController::idle() const {
+    return queued.empty() && inFlight.empty() && statusSinceDrain && machine.state == GrblState::Idle;
+}
+
+void GrblController::realtime(char command) {
+    link.write(&command, 1);
+    if (command == 0x18) {
+        // GRBL drops its buffers on reset, so nothing sent is going to be acknowledged.
+        inFlight.clear();
+        inFlightBytes = 0;
+        machine.state = GrblState::Unknown;
+    }
+}
+
+void GrblController::poll(uint32_t nowMs) {
+    while (!queued.empty() && inFlightBytes + queued.front().size() + 1 <= RX_BUFFER_SIZE) {
+        std::string line = queued.front() + '\n';
+        queued.pop_front();
+        link.write(line.data(), line.size());
+        inFlight.push_back(line.size());
+        inFlightBytes += line.size();
+    }
+
+    while (link.available() > 0) {
+        int c = link.read();
+        if (c < 0) break;
+        if (c == '\n') {
+            if (!received.empty() && received.back() == '\r') received.pop_back();
+            if (!received.empty()) handleLine(received);
+            received.clear();
+        } else {
+            received += static_cast<char>(c);
+        }
+    }
+
+    bool waiting = !queued.empty() || !inFlight.empty() || !idleCallbacks.empty();
+    if (waiting && (!statusRequested || nowMs - lastStatusMs >= STATUS_INTERVAL_MS)) {
+        realtime('?');
+        statusRequested = true;
+        lastStatusMs = nowMs;
+    }
+
+    if (!idleCallbacks.empty() && idle()) {
+        // A callback may queue the next leg and register its own onIdle, so run the current batch only.
+        std::vector<std::function<void()>> callbacks;
+        callbacks.swap(idleCallbacks);
+        for (auto &callback : callbacks) callback();
+    }
+}
+
+void GrblController::handleLine(const std::string &line) {
+    if (line == "ok" || line.compare(0, 6, "error:") == 0) {
+        if (line[0] == 'e') {
+            errorCount++;
+            acceleration = 0; // the failed line may have been a setting, so send the next one regardless
+        }
+        if (!inFlight.empty()) {
+            inFlightBytes -= inFlight.front();
+            inFlight.pop_front();
+        }
+        statusSinceDrain = false;
+    } else if (line[0] == '<') {
+        parseStatus(line);
+        statusRequested = false;
+        if (inFlight.empty() && queued.empty()) statusSinceDrain = true;
+    } else if (line.compare(0, 6, "ALARM:") == 0) {
+        machine.state = GrblState::Alarm;
+    } else if (line.compare(0, 5, "Grbl ") == 0) {
+        inFlight.clear();
+        inFlightBytes = 0;
+        machine.state = GrblState::Unknown;
+    }
+    // [MSG:...], [GC:...] and other feedback lines carry nothing the controller tracks.
+}
+
+// <Idle|MPos:0.000,0.000,0.000|FS:0,0> — the state may carry a substate, e.g. "Hold:0".
+void GrblController::parseStatus(const std::string &report) {
+    static const struct {
+        const char *name;
+        GrblState state;
+    } STATES[] = {{"Idle", GrblState::Idle}, {"Run", GrblState::Run},     {"Hold", GrblState::Hold},
+                  {"Jog", GrblState::Jog},   {"Alarm", GrblState::Alarm}, {"Door", GrblState::Door},
+                  {"Check", GrblState::Check}, {"Home", GrblState::Home}, {"Sleep", GrblState::Sleep}};
+
+    size_t end = report.find_first_of("|:>", 1);
+    std::string name = report.substr(1, end - 1);
+    machine.state = GrblState::Unknown;
+    for (const auto &entry : STATES) {
+        if (name == entry.name) machine.state = entry.state;
+    }
+
+    size_t pos = report.find("MPos:");
+    if (pos == std::string::npos) pos = report.find("WPos:");
+    if (pos != std::string::npos) {
+        const char *p = report.c_str() + pos + 5;
+        char *next;
+        machine.x = strtof(p, &next);
+        if (*next == ',') machine.y = strtof(next + 1, &next);
+        if (*next == ',') machine.z = strtof(next + 1, &next);
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef GRBL_CONTROLLER_H
+#define GRBL_CONTROLLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+// The byte stream to GRBL. The firmware wraps its HardwareSerial; on Linux a simulator or a tty stands in.
+class GrblLink {
+public:
+    virtual ~GrblLink() = default;
+    virtual int available() = 0;
+    virtual int read() = 0; // next byte, or -1 when none is waiting
+    virtual void write(const char *data, size_t length) = 0;
+};
+
+enum class GrblState : uint8_t { Unknown, Idle, Run, Hold, Jog, Alarm, Door, Check, Home, Sleep };
+
+// The latest real-time status report.
+struct GrblStatus {
+    GrblState state = GrblState::Unknown;
+    float x = 0, y = 0, z = 0; // machine position in mm
+};
+
+// Streams G-code with GRBL's character-counting protocol: lines are sent as long as every unacknowledged
+// byte still fits in GRBL's serial receive buffer, so its planner always holds the next segments and
+// consecutive moves blend instead of stopping at each one. Nothing blocks; the owner calls poll() from
+// its loop and hears about completed motion through onIdle().
+class GrblController {
+public:
+    static constexpr size_t RX_BUFFER_SIZE = 128; // GRBL's serial receive buffer
+    static constexpr uint32_t STATUS_INTERVAL_MS = 50;
+
+    explicit GrblController(GrblLink &link);
+
+    void send(const std::string &program); // queue a line such as "$H", or several separated by newlines
+    void moveTo(float x, float y, int feedRate = 0); // feedRate 0 is a rapid (G0)
+    // Queues $120/$121 when the value differs from the last one sent. GRBL rejects settings unless it is
+    // idle and rewrites its EEPROM for each one, so call this from onIdle and keep to one value.
+    void setAcceleration(int mmPerSec2);
+    // Runs once, from poll(), after everything queued so far has executed and GRBL reports Idle.
+    void onIdle(std::function<void()> callback);
+    // Drops every line not yet sent and every pending onIdle callback, e.g. when the game is abandoned
+    // mid-move. Lines already in GRBL's buffer still run; follow with realtime(0x18) to stop those too.
+    void clear();
+
+    // Sends whatever fits, consumes responses and asks for a status report every STATUS_INTERVAL_MS while
+    // motion is outstanding.
+    void poll(uint32_t nowMs);
+
+    // Real-time commands bypass the buffer: '!' feed hold, '~' resume, 0x18 soft reset.
+    void realtime(char command);
+
+    // Nothing queued, nothing in flight and the last report, taken after the final ack, said Idle.
+    bool idle() const;
+    const GrblStatus &status() const { return machine; }
+    size_t pending() const { return queued.size() + inFlight.size(); }
+    uint32_t errors() const { return errorCount; }
+
+private:
+    void handleLine(const std::string &line);
+    void parseStatus(const std::string &report);
+
+    GrblLink &link;
+    std::deque<std::string> queued;
+    std::deque<size_t> inFlight; // length of each sent line awaiting ok/error, newline included
+    size_t inFlightBytes = 0;
+    std::vector<std::function<void()>> idleCallbacks;
+    std::string received;
+    GrblStatus machine;
+    bool statusSinceDrain = false; // a report arrived after the last ack, so machine.state is current
+    bool statusRequested = false;
+    uint32_t lastStatusMs = 0;
+    uint32_t errorCount = 0;
+    int acceleration = 0; // last value sent, 0 before the first
+};
+
+#endif
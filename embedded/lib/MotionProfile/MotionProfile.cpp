@@ -0,0 +1,107 @@
+#include "MotionProfile.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+const char *PIECE_NAMES[6] = {"pawn", "knight", "bishop", "rook", "queen", "king"};
+
+bool congested(Waypoint point, Bitboard others) {
+    const float board = 8 * PathPlanner::SQUARE_MM;
+    if (point.x > board || point.y > board) return true;
+    while (others) {
+        int square = popLsb(others);
+        float left = fileOf(square) * PathPlanner::SQUARE_MM, bottom = rankOf(square) * PathPlanner::SQUARE_MM;
+        float dx = std::max({left - point.x, 0.0f, point.x - left - PathPlanner::SQUARE_MM});
+        float dy = std::max({bottom - point.y, 0.0f, point.y - bottom - PathPlanner::SQUARE_MM});
+        if (std::hypot(dx, dy) < MotionProfiles::CLEARANCE_MM) return true;
+    }
+    return false;
+}
+
+} // namespace
+
+// Tall pieces (king, queen) tip over first, pawns and rooks are short and sit steady.
+MotionProfiles::MotionProfiles() : acceleration(250), travelFeedRate(0) {
+    carry[PAWN] = {{4000, 2500}};
+    carry[KNIGHT] = {{3500, 2000}};
+    carry[BISHOP] = {{3500, 2000}};
+    carry[ROOK] = {{4000, 2500}};
+    carry[QUEEN] = {{3000, 1800}};
+    carry[KING] = {{2500, 1500}};
+}
+
+bool MotionProfiles::set(const std::string &setting) {
+    size_t equals = setting.find('=');
+    if (equals == std::string::npos) return false;
+    std::string name = setting.substr(0, equals);
+    const char *value = setting.c_str() + equals + 1;
+    if (name == "travel") {
+        int feedRate;
+        if (sscanf(value, "%d", &feedRate) != 1 || feedRate < 0) return false;
+        travelFeedRate = feedRate;
+        return true;
+    }
+    if (name == "acceleration") {
+        int mmPerSec2;
+        if (sscanf(value, "%d", &mmPerSec2) != 1 || mmPerSec2 <= 0) return false;
+        acceleration = mmPerSec2;
+        return true;
+    }
+
+    size_t dot = name.find('.');
+    std::string mode = dot == std::string::npos ? "" : name.substr(dot + 1);
+    if (mode != "open" && mode != "congested") return false;
+    for (int type = PAWN; type <= KING; ++type) {
+        if (name.compare(0, dot, PIECE_NAMES[type]) != 0) continue;
+        int feedRate;
+        if (sscanf(value, "%d", &feedRate) != 1 || feedRate <= 0) return false;
+        carry[type][mode == "congested"] = feedRate;
+        return true;
+    }
+    return false;
+}
+
+std::string MotionProfiles::program(const CncLeg &leg) const {
+    const auto &feedRates = carry[typeOf(leg.piece)];
+
+    // Cut every segment into half-square steps, classify each by its midpoint and merge neighbouring steps
+    // of the same class back into runs.
+    struct Run {
+        Waypoint end;
+        bool congested;
+    };
+    std::vector<Run> runs;
+    for (size_t i = 1; i < leg.path.size(); ++i) {
+        Waypoint a = leg.path[i - 1], b = leg.path[i];
+        float span = std::max(std::fabs(b.x - a.x), std::fabs(b.y - a.y));
+        int steps = std::max(1, int(std::lround(span / (PathPlanner::SQUARE_MM / 2))));
+        for (int k = 1; k <= steps; ++k) {
+            float t = float(k) / steps, mid = (k - 0.5f) / steps;
+            Waypoint end{a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t};
+            bool slow = congested({a.x + (b.x - a.x) * mid, a.y + (b.y - a.y) * mid}, leg.others);
+            if (k > 1 && runs.back().congested == slow) {
+                runs.back().end = end;
+            } else {
+                runs.push_back({end, slow});
+            }
+        }
+    }
+
+    std::string program;
+    int feed = 0;
+    for (const Run &run : runs) {
+        int feedRate = feedRates[run.congested];
+        char line[48];
+        if (feedRate != feed) {
+            snprintf(line, sizeof(line), "G1 X%.1f Y%.1f F%d\n", run.end.x, run.end.y, feedRate);
+        } else {
+            snprintf(line, sizeof(line), "G1 X%.1f Y%.1f\n", run.end.x, run.end.y);
+        }
+        feed = feedRate;
+        program += line;
+    }
+    return program;
+}
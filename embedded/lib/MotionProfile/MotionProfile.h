@@ -0,0 +1,32 @@
+#ifndef MOTION_PROFILE_H
+#define MOTION_PROFILE_H
+
+#include <CncMovePlanner.h>
+#include <array>
+#include <string>
+
+// How fast to carry each kind of piece, in the open and where the path passes close to other pieces.
+// GRBL stores $120/$121 in EEPROM on every write, so the gantry keeps one acceleration, gentle enough for
+// the tallest piece, and each leg is shaped through its feed rates alone: the feed changes per run, so the
+// open stretches of a leg still go fast.
+class MotionProfiles {
+public:
+    // A step whose midpoint is closer than this to another piece's square is congested. The lanes run
+    // along square edges, so a lane next to any piece always is; the graveyard always counts as congested.
+    static constexpr float CLEARANCE_MM = 20;
+
+    MotionProfiles();
+
+    // "knight.open=5000", "king.congested=1500", "travel=9000" or "acceleration=300". False, and nothing
+    // changed, if it doesn't parse.
+    bool set(const std::string &setting);
+
+    // The G-code that carries the piece along the leg.
+    std::string program(const CncLeg &leg) const;
+
+    int acceleration;   // mm/s², sent to GRBL as $120/$121 and the same for every leg
+    int travelFeedRate; // magnet off, nothing to drop; 0 (the default) travels at GRBL's rapid rate, G0
+    std::array<std::array<int, 2>, 6> carry; // feed rate in mm/min, [PieceType][congested]
+};
+
+#endif
@@ -0,0 +1,100 @@
+#include "PathPlanner.h"
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <queue>
+
+namespace {
+
+// Grid points are half a square apart: even coordinates lie on a lane, odd ones through square centres.
+const int GRID = 17;
+const int DIRECTIONS = 8;
+const int DX[DIRECTIONS] = {1, 1, 0, -1, -1, -1, 0, 1};
+const int DY[DIRECTIONS] = {0, 1, 1, 1, 0, -1, -1, -1};
+
+// A step's midpoint is inside a square unless it runs along a lane; returns that square or -1.
+int squareCrossed(int x, int y, int dir) {
+    int mx = 2 * x + DX[dir], my = 2 * y + DY[dir]; // midpoint in quarter squares
+    if (mx % 4 == 0 || my % 4 == 0) return -1;
+    return (my / 4) * 8 + mx / 4;
+}
+
+} // namespace
+
+std::vector<Waypoint> PathPlanner::route(int from, int to, uint64_t occupied) {
+    uint64_t blocked = occupied & ~(1ULL << from) & ~(1ULL << to);
+    return route(GridPoint{(from % 8) * 2 + 1, (from / 8) * 2 + 1}, GridPoint{(to % 8) * 2 + 1, (to / 8) * 2 + 1}, blocked);
+}
+
+std::vector<Waypoint> PathPlanner::route(GridPoint from, GridPoint to, uint64_t blocked) {
+    int startX = from.x, startY = from.y;
+    int goalX = to.x, goalY = to.y;
+
+    // Dijkstra over (point, direction of arrival), so turns can be charged for.
+    const int STATES = GRID * GRID * (DIRECTIONS + 1);
+    std::vector<float> cost(STATES, INFINITY);
+    std::vector<int> previous(STATES, -1);
+    using Entry = std::pair<float, int>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+    int start = (startY * GRID + startX) * (DIRECTIONS + 1) + DIRECTIONS; // no direction yet
+    cost[start] = 0;
+    open.push({0, start});
+
+    int goal = -1;
+    while (!open.empty()) {
+        auto [distance, state] = open.top();
+        open.pop();
+        if (distance > cost[state]) continue;
+        int point = state / (DIRECTIONS + 1), arrived = state % (DIRECTIONS + 1);
+        int x = point % GRID, y = point / GRID;
+        if (x == goalX && y == goalY) {
+            goal = state;
+            break;
+        }
+        for (int dir = 0; dir < DIRECTIONS; ++dir) {
+            int nx = x + DX[dir], ny = y + DY[dir];
+            if (nx < 0 || ny < 0 || nx >= GRID || ny >= GRID) continue;
+            int square = squareCrossed(x, y, dir);
+            if (square >= 0 && (blocked >> square & 1)) continue;
+            float step = (dir % 2 ? std::sqrt(2.0f) : 1.0f) * SQUARE_MM / 2;
+            if (arrived != DIRECTIONS && arrived != dir) step += TURN_PENALTY_MM;
+            int next = (ny * GRID + nx) * (DIRECTIONS + 1) + dir;
+            if (distance + step < cost[next]) {
+                cost[next] = distance + step;
+                previous[next] = state;
+                open.push({cost[next], next});
+            }
+        }
+    }
+    if (goal < 0) return {};
+
+    // Walk back, keeping only the points where the direction changes.
+    std::vector<Waypoint> path;
+    int lastDir = -1;
+    for (int state = goal; state >= 0; state = previous[state]) {
+        int point = state / (DIRECTIONS + 1), dir = state % (DIRECTIONS + 1);
+        if (dir != lastDir) path.push_back({(point % GRID) * SQUARE_MM / 2, (point / GRID) * SQUARE_MM / 2});
+        lastDir = dir;
+    }
+    return {path.rbegin(), path.rend()};
+}
+
+float PathPlanner::length(const std::vector<Waypoint> &path) {
+    float total = 0;
+    for (size_t i = 1; i < path.size(); ++i) total += std::hypot(path[i].x - path[i - 1].x, path[i].y - path[i - 1].y);
+    return total;
+}
+
+std::string PathPlanner::toGcode(const std::vector<Waypoint> &path, int feedRate) {
+    std::string program;
+    for (size_t i = 1; i < path.size(); ++i) {
+        char line[48];
+        if (i == 1) {
+            snprintf(line, sizeof(line), "G1 X%.1f Y%.1f F%d\n", path[i].x, path[i].y, feedRate);
+        } else {
+            snprintf(line, sizeof(line), "G1 X%.1f Y%.1f\n", path[i].x, path[i].y);
+        }
+        program += line;
+    }
+    return program;
+}
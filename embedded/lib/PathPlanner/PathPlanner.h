@@ -0,0 +1,44 @@
+#ifndef PATH_PLANNER_H
+#define PATH_PLANNER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A point in machine coordinates, in mm. The centre of a1 is (30, 30).
+struct Waypoint {
+    float x, y;
+    bool operator==(const Waypoint &other) const { return x == other.x && y == other.y; }
+};
+
+// A point of the search grid, in half squares from the a1 corner: odd coordinates are square centres,
+// even ones lie on a lane.
+struct GridPoint {
+    int x, y;
+};
+
+// Routes the gantry for a piece held by the magnet. Pieces are narrower than a square, so the lines
+// between squares (edge lanes) are always free; a piece may also cross the inside of any empty square.
+// The search runs on a half-square grid (square centres, lane midpoints and lane crossings), so it finds
+// straight runs through empty squares as well as detours along the lanes.
+class PathPlanner {
+public:
+    static constexpr float SQUARE_MM = 60;
+    // Every corner costs a deceleration, so a slightly longer path with fewer turns usually runs faster.
+    static constexpr float TURN_PENALTY_MM = 20;
+
+    static Waypoint squareCenter(int square) { return {(square % 8) * SQUARE_MM + SQUARE_MM / 2, (square / 8) * SQUARE_MM + SQUARE_MM / 2}; }
+
+    // Shortest path from the centre of one square (a1 = 0) to another that enters no occupied square other
+    // than the two endpoints. Starts at from's centre, ends at to's, and only keeps the corners.
+    static std::vector<Waypoint> route(int from, int to, uint64_t occupied);
+    // The same search between any two grid points, never entering a square in blocked.
+    static std::vector<Waypoint> route(GridPoint from, GridPoint to, uint64_t blocked);
+
+    static float length(const std::vector<Waypoint> &path);
+
+    // One G1 line per segment after the starting point, with the feed rate set on the first.
+    static std::string toGcode(const std::vector<Waypoint> &path, int feedRate);
+};
+
+#endif
@@ -5,121 +5,87 @@
 #include "XYPos.h"
 
 // Constructor Implementation
-Piece::Piece(Color _color, Index _index) : color(_color), index(_index), moved(false), name("Piece") {}
+Piece::Piece(Color _color, Index _index, PieceType _type)
+    : color(_color), index(_index), moved(false), movedTwice(false), type(_type) {}
 
 bool Piece::hasMoved() const {
     return this->moved;
 }
 
-std::vector<std::array<int, 2>> Piece::movements() {
-    return {{0, 0}};
-}
-
-bool Piece::slidingPiece() {
-    return false;
-}
-
-bool Piece::operator==(const Piece &p) const {
-    return this->color == p.color && this->index == p.index && this->name == p.name;
-}
-std::unordered_map<std::string, char> pieceMap = {
-    {"Pawn", 'P'},
-    {"Knight", 'N'},
-    {"Bishop", 'B'},
-    {"Castle", 'R'},
-    {"Queen", 'Q'},
-    {"King", 'K'}};
-
-std::ostream &operator<<(std::ostream &os, const Piece &piece) {
-    char c = pieceMap[piece.name];
-    os << (piece.color == Color::Black ? static_cast<char>(std::tolower(c)) : c);
-    return os;
-}
-
-// Pawn Implementation
-Pawn::Pawn(Color _color, Index _index) : Piece(_color, _index), movedTwice(false) {
-    this->name = "Pawn";
-}
-
-std::vector<std::array<int, 2>> Pawn::movements() {
-    if (this->color == Color::White) {
-        if (this->moved) {
-            return {{0, 1}, {1, 1}, {-1, 1}};
-        } else {
-            return {{0, 1}, {1, 1}, {-1, 1}, {0, 2}};
-        }
-    } else {
-        if (this->moved) {
-            return {{0, -1}, {-1, -1}, {1, -1}};
-        } else {
-            return {{0, -1}, {-1, -1}, {1, -1}, {0, -2}};
-        }
+Offsets Piece::movements() const {
+    switch (type) {
+    case PAWN: {
+        const auto &offsets = color == White ? Pawn::WHITE_OFFSETS : Pawn::BLACK_OFFSETS;
+        return {offsets.data(), moved ? 3 : 4};
     }
+    case KNIGHT:
+        return {Knight::OFFSETS.data(), static_cast<int>(Knight::OFFSETS.size())};
+    case BISHOP:
+        return {Bishop::OFFSETS.data(), static_cast<int>(Bishop::OFFSETS.size())};
+    case ROOK:
+        return {Castle::OFFSETS.data(), static_cast<int>(Castle::OFFSETS.size())};
+    case QUEEN:
+        return {Queen::OFFSETS.data(), static_cast<int>(Queen::OFFSETS.size())};
+    case KING:
+        return {King::OFFSETS.data(), moved ? 8 : 10};
+    }
+    return {nullptr, 0};
 }
 
-// Knight Implementation
-Knight::Knight(Color _color, Index _index) : Piece(_color, _index) {
-    this->name = "Knight";
+bool Piece::slidingPiece() const {
+    return type == BISHOP || type == ROOK || type == QUEEN;
 }
 
-std::vector<std::array<int, 2>> Knight::movements() {
-    return {{1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}};
+bool Piece::operator==(const Piece &p) const {
+    return this->color == p.color && this->index == p.index && this->type == p.type;
 }
 
-// Castle Implementation
-Castle::Castle(Color _color, Index _index) : Piece(_color, _index) {
-    this->name = "Castle";
-}
+// Indexed by PieceType; names are only built for display.
+const char *pieceNames[] = {"Pawn", "Knight", "Bishop", "Castle", "Queen", "King"};
+const char pieceChars[] = {'P', 'N', 'B', 'R', 'Q', 'K'};
 
-std::vector<std::array<int, 2>> Castle::movements() {
-    return {{0, 1}, {1, 0}};
+std::string Piece::name() const {
+    return pieceNames[type];
 }
 
-bool Castle::slidingPiece() {
-    return true;
-}
-
-// Bishop Implementation
-Bishop::Bishop(Color _color, Index _index) : Piece(_color, _index) {
-    this->name = "Bishop";
+std::ostream &operator<<(std::ostream &os, const Piece &piece) {
+    char c = pieceChars[piece.type];
+    os << (piece.color == Color::Black ? static_cast<char>(std::tolower(c)) : c);
+    return os;
 }
 
-std::vector<std::array<int, 2>> Bishop::movements() {
-    return {{1, 1}, {1, -1}};
-}
+Pawn::Pawn(Color _color, Index _index) : Piece(_color, _index, PAWN) {}
 
-bool Bishop::slidingPiece() {
-    return true;
-}
+Knight::Knight(Color _color, Index _index) : Piece(_color, _index, KNIGHT) {}
 
-// Queen Implementation
-Queen::Queen(Color _color, Index _index) : Piece(_color, _index) {
-    this->name = "Queen";
-}
+Castle::Castle(Color _color, Index _index) : Piece(_color, _index, ROOK) {}
 
-std::vector<std::array<int, 2>> Queen::movements() {
-    return {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
-}
+Bishop::Bishop(Color _color, Index _index) : Piece(_color, _index, BISHOP) {}
 
-bool Queen::slidingPiece() {
-    return true;
-}
+Queen::Queen(Color _color, Index _index) : Piece(_color, _index, QUEEN) {}
 
-// King Implementation
-King::King(Color _color, Index _index) : Piece(_color, _index) {
-    this->name = "King";
-}
+King::King(Color _color, Index _index) : Piece(_color, _index, KING) {}
 
-std::vector<std::array<int, 2>> King::movements() {
-    if (this->hasMoved()) {
-        return {{0, 1}, {1, 1}, {1, -1}, {0, -1}, {-1, -1}, {-1, 0}, {-1, 1},{1,0}};
+std::shared_ptr<Piece> createPiece(Color color, Index index, PieceType type) {
+    switch (type) {
+    case PAWN:
+        return std::make_shared<Pawn>(color, index);
+    case KNIGHT:
+        return std::make_shared<Knight>(color, index);
+    case BISHOP:
+        return std::make_shared<Bishop>(color, index);
+    case ROOK:
+        return std::make_shared<Castle>(color, index);
+    case QUEEN:
+        return std::make_shared<Queen>(color, index);
+    default:
+        return std::make_shared<King>(color, index);
     }
-    return {{0, 1}, {1, 1}, {1, -1}, {0, -1}, {-1, -1}, {-1, 0}, {-1, 1} ,{1,0},{-2, 0}, {2, 0}};
 }
 
 // Hash Function Implementation
 std::size_t std::hash<Piece>::operator()(const Piece &p) const {
-    std::size_t h1 = std::hash<std::string>()(p.name);
+    std::size_t h1 = std::hash<int>()(p.type);
     std::size_t h2 = std::hash<int>()(int(p.index));
     std::size_t h3 = std::hash<int>()(p.color);
     return h1 ^ (h2 << 1) ^ (h3 << 2);
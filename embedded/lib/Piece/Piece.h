@@ -1,37 +1,45 @@
 #ifndef PIECE_H
 #define PIECE_H
 
+#include <Constants.h>
 #include <XYPos.h>
 #include <array>
-#include <functional>
+#include <memory>
 #include <iostream>
 #include <string>
 #include <vector>
 
-enum Color {
-    Black,
-    White
-};
-
+using Offset = std::array<int, 2>;
 
+// A view over one of the static movement tables below; no allocation per query.
+struct Offsets {
+    const Offset *first;
+    int count;
+    const Offset *begin() const { return first; }
+    const Offset *end() const { return first + count; }
+    int size() const { return count; }
+};
 
+// Pieces are plain values: the subclasses only fix the type and hold the movement tables,
+// so nothing here needs a vtable.
 class Piece {
 public:
     Color color;
     Index index;
     bool moved;
-    std::string name;
+    bool movedTwice; // pawns only: the last move of this pawn was a double push
+    PieceType type;
     Piece() = default;
-    Piece(Color _color, Index _index);
+    Piece(Color _color, Index _index, PieceType _type);
 
-    virtual ~Piece() = default;
+    Offsets movements() const;
 
-    virtual std::vector<std::array<int, 2>> movements();
-
-    virtual bool slidingPiece();
+    bool slidingPiece() const;
 
     bool hasMoved() const;
 
+    std::string name() const;
+
     friend std::ostream &operator<<(std::ostream &os, const Piece &piece);
 
     bool operator==(const Piece &p) const;
@@ -39,54 +47,51 @@ public:
 
 class Pawn : public Piece {
 public:
-    bool movedTwice;
+    static constexpr std::array<Offset, 4> WHITE_OFFSETS = {{{0, 1}, {1, 1}, {-1, 1}, {0, 2}}};
+    static constexpr std::array<Offset, 4> BLACK_OFFSETS = {{{0, -1}, {-1, -1}, {1, -1}, {0, -2}}};
 
     Pawn(Color _color, Index _index);
-
-    std::vector<std::array<int, 2>> movements() override;
 };
 
 class Knight : public Piece {
 public:
-    Knight(Color _color, Index _index);
+    static constexpr std::array<Offset, 8> OFFSETS = {{{1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}}};
 
-    std::vector<std::array<int, 2>> movements() override;
+    Knight(Color _color, Index _index);
 };
 
 class Castle : public Piece {
 public:
-    Castle(Color _color, Index _index);
-
-    std::vector<std::array<int, 2>> movements() override;
+    static constexpr std::array<Offset, 2> OFFSETS = {{{0, 1}, {1, 0}}};
 
-    bool slidingPiece() override;
+    Castle(Color _color, Index _index);
 };
 
 class Bishop : public Piece {
 public:
-    Bishop(Color _color, Index _index);
-
-    std::vector<std::array<int, 2>> movements() override;
+    static constexpr std::array<Offset, 2> OFFSETS = {{{1, 1}, {1, -1}}};
 
-    bool slidingPiece() override;
+    Bishop(Color _color, Index _index);
 };
 
 class Queen : public Piece {
 public:
-    Queen(Color _color, Index _index);
+    static constexpr std::array<Offset, 4> OFFSETS = {{{0, 1}, {1, 0}, {1, 1}, {1, -1}}};
 
-    std::vector<std::array<int, 2>> movements() override;
-
-    bool slidingPiece() override;
+    Queen(Color _color, Index _index);
 };
 
 class King : public Piece {
 public:
-    King(Color _color, Index _index);
+    // The two castling steps come last so an unmoved king can use the whole table.
+    static constexpr std::array<Offset, 10> OFFSETS = {
+        {{0, 1}, {1, 1}, {1, -1}, {0, -1}, {-1, -1}, {-1, 0}, {-1, 1}, {1, 0}, {-2, 0}, {2, 0}}};
 
-    std::vector<std::array<int, 2>> movements() override;
+    King(Color _color, Index _index);
 };
 
+std::shared_ptr<Piece> createPiece(Color color, Index index, PieceType type);
+
 namespace std {
 template <>
 struct hash<Piece> {
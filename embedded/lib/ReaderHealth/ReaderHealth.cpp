@@ -0,0 +1,41 @@
+#include "ReaderHealth.h"
+
+bool ReaderHealth::needsInit(int reader, uint32_t nowMs) const {
+    const Reader &r = readers[reader];
+    return !r.ready || (reinitMs && nowMs - r.initializedAt >= reinitMs);
+}
+
+void ReaderHealth::initialized(int reader, uint32_t nowMs, bool ok) {
+    Reader &r = readers[reader];
+    r.inits++;
+    r.initializedAt = nowMs;
+    r.ready = ok;
+    if (!ok) r.failures++;
+}
+
+void ReaderHealth::lost(int reader) {
+    readers[reader].ready = false;
+    readers[reader].failures++;
+}
+
+void ReaderHealth::invalidate() {
+    for (Reader &r : readers) r.ready = false;
+}
+
+std::string ReaderHealth::report() const {
+    uint32_t polls = 0, inits = 0, failures = 0;
+    std::string failing;
+    for (int i = 0; i < NUM_READERS; ++i) {
+        const Reader &r = readers[i];
+        polls += r.polls;
+        inits += r.inits;
+        failures += r.failures;
+        if (r.failures) {
+            failing += ' ';
+            failing += char('a' + i % 8);
+            failing += char('1' + i / 8);
+            failing += ':' + std::to_string(r.failures);
+        }
+    }
+    return "polls=" + std::to_string(polls) + " inits=" + std::to_string(inits) + " failures=" + std::to_string(failures) + failing;
+}
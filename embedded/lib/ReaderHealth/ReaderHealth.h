@@ -0,0 +1,42 @@
+#ifndef READER_HEALTH_H
+#define READER_HEALTH_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+// Which RFID readers have been set up and how they have been behaving. PCD_Init soft-resets the selected
+// MFRC522 and waits for its oscillator, which costs far more than reading a tag, and what it configures
+// stays put until the chip loses power. So each reader is initialised once, and again only after it fails
+// a check or when reinitMs has passed since the last time (0 turns the timer off).
+class ReaderHealth {
+public:
+    static constexpr int NUM_READERS = 64;
+
+    struct Reader {
+        bool ready = false; // initialised and passed its last check
+        uint32_t initializedAt = 0;
+        uint32_t polls = 0;
+        uint32_t inits = 0;
+        uint32_t failures = 0; // checks that failed, before or after an init
+    };
+
+    explicit ReaderHealth(uint32_t reinitMs = 60000) : reinitMs(reinitMs) {}
+
+    bool needsInit(int reader, uint32_t nowMs) const;
+    void polled(int reader) { readers[reader].polls++; }
+    void initialized(int reader, uint32_t nowMs, bool ok);
+    void lost(int reader); // a reader that was ready failed its check
+    void invalidate();     // initialise every reader again, e.g. after the reader rail was power cycled
+
+    const Reader &operator[](int reader) const { return readers[reader]; }
+    // "polls=640 inits=66 failures=2 e4:2", with the squares whose reader has failed and how often.
+    std::string report() const;
+
+    uint32_t reinitMs;
+
+private:
+    std::array<Reader, NUM_READERS> readers;
+};
+
+#endif
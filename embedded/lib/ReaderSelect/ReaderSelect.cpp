@@ -0,0 +1,18 @@
+#include "ReaderSelect.h"
+
+void ReaderSelect::select(int reader) {
+    int ahead = reader - current;
+    if (current >= 0 && ahead >= 0 && ahead <= MAX_STEP) {
+        if (ahead) {
+            chain.clockZeros(ahead);
+            stepCount++;
+        }
+    } else {
+        // The last byte written ends up in the first register.
+        uint8_t bytes[NUM_READERS / 8] = {};
+        bytes[NUM_READERS / 8 - 1 - reader / 8] = 1 << (reader % 8);
+        chain.write(bytes, sizeof(bytes));
+        writeCount++;
+    }
+    current = reader;
+}
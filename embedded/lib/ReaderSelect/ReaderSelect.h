@@ -0,0 +1,41 @@
+#ifndef READER_SELECT_H
+#define READER_SELECT_H
+
+#include <cstddef>
+#include <cstdint>
+
+// The clock and data lines of the shift-register chain whose outputs select the RFID readers. Reader i is
+// output i: a bit clocked in lands on output 0 and every bit already in the chain moves one output along.
+// The firmware drives it from a hardware SPI host; the tests model the chain.
+class ShiftChain {
+public:
+    virtual ~ShiftChain() = default;
+    virtual void write(const uint8_t *bytes, size_t count) = 0; // MSB first
+    virtual void clockZeros(int count) = 0;                     // 1 to MAX_STEP clocks with the data line low
+};
+
+// Selects one reader at a time. A reader a little further along the chain is reached by clocking the
+// one-hot bit forward; anything else rewrites the whole chain in one transfer. A sweep across the board
+// therefore costs one clock per square instead of 64.
+class ReaderSelect {
+public:
+    static constexpr int NUM_READERS = 64;
+    static constexpr int MAX_STEP = 32; // the most bits one transfer clocks out
+
+    explicit ReaderSelect(ShiftChain &chain) : chain(chain) {}
+
+    void select(int reader);
+    void forget() { current = -1; } // the chain was cleared or disturbed; the next select rewrites it
+    int selected() const { return current; }
+
+    uint32_t writes() const { return writeCount; }
+    uint32_t steps() const { return stepCount; }
+
+private:
+    ShiftChain &chain;
+    int current = -1;
+    uint32_t writeCount = 0;
+    uint32_t stepCount = 0;
+};
+
+#endif
@@ -0,0 +1,36 @@
+#include "ScanScheduler.h"
+
+namespace {
+
+// Round-robin over a set: the first square at or after cursor, wrapping around; -1 if the set is empty.
+int nextIn(uint64_t squares, int &cursor) {
+    if (!squares) return -1;
+    uint64_t ahead = squares & (~0ULL << cursor);
+    int square = __builtin_ctzll(ahead ? ahead : squares);
+    cursor = (square + 1) & 63;
+    return square;
+}
+
+} // namespace
+
+void ScanScheduler::changed(int square, uint32_t nowMs) {
+    recentSquares |= 1ULL << square;
+    changedAt[square] = nowMs;
+}
+
+int ScanScheduler::next(uint32_t nowMs) {
+    for (uint64_t squares = recentSquares; squares; squares &= squares - 1) {
+        int square = __builtin_ctzll(squares);
+        if (nowMs - changedAt[square] > RECENT_MS) recentSquares &= ~(1ULL << square);
+    }
+
+    int slot = turn++ % 8;
+    int square = -1;
+    if (slot < 6) square = nextIn(hotSquares, hotCursor);
+    if (square < 0 && slot < 7) square = nextIn(recentSquares, recentCursor);
+    if (square < 0) {
+        square = backgroundCursor;
+        backgroundCursor = (backgroundCursor + 1) & 63;
+    }
+    return square;
+}
@@ -0,0 +1,33 @@
+#ifndef SCAN_SCHEDULER_H
+#define SCAN_SCHEDULER_H
+
+#include <array>
+#include <cstdint>
+
+// Chooses which RFID reader to poll next, so a change is seen within a few polls instead of a full sweep.
+// Hot squares are where a change is expected next: the origin and legal destinations of a lifted piece, or
+// every piece that can move while nothing is lifted. They get six polls in every eight. Squares that changed
+// in the last RECENT_MS get one, and one goes round all 64 squares in turn, so a piece put down somewhere
+// unexpected is still seen within 512 polls. A turn whose set is empty passes to the next one down.
+class ScanScheduler {
+public:
+    static constexpr uint32_t RECENT_MS = 2000;
+
+    void setHot(uint64_t squares) { hotSquares = squares; } // a1 = bit 0
+    void changed(int square, uint32_t nowMs);
+    int next(uint32_t nowMs);
+
+    uint64_t hot() const { return hotSquares; }
+    uint64_t recent() const { return recentSquares; }
+
+private:
+    uint64_t hotSquares = 0;
+    uint64_t recentSquares = 0;
+    std::array<uint32_t, 64> changedAt{};
+    int hotCursor = 0;
+    int recentCursor = 0;
+    int backgroundCursor = 0;
+    uint32_t turn = 0;
+};
+
+#endif
@@ -0,0 +1,344 @@
+#include "Search.h"
+#include <algorithm>
+#include <thread>
+
+namespace {
+
+const int INFINITE_SCORE = MATE_SCORE + 1;
+const int MATE_BOUND = MATE_SCORE - MAX_PLY;
+
+constexpr int PIECE_VALUES[6] = {100, 320, 330, 500, 900, 0};
+
+// Piece-square tables from white's point of view, laid out as printed: a8 first, h1 last.
+constexpr int8_t PIECE_SQUARE[6][64] = {
+    { // pawn
+          0,   0,   0,   0,   0,   0,   0,   0,
+         50,  50,  50,  50,  50,  50,  50,  50,
+         10,  10,  20,  30,  30,  20,  10,  10,
+          5,   5,  10,  25,  25,  10,   5,   5,
+          0,   0,   0,  20,  20,   0,   0,   0,
+          5,  -5, -10,   0,   0, -10,  -5,   5,
+          5,  10,  10, -20, -20,  10,  10,   5,
+          0,   0,   0,   0,   0,   0,   0,   0,
+    },
+    { // knight
+        -50, -40, -30, -30, -30, -30, -40, -50,
+        -40, -20,   0,   0,   0,   0, -20, -40,
+        -30,   0,  10,  15,  15,  10,   0, -30,
+        -30,   5,  15,  20,  20,  15,   5, -30,
+        -30,   0,  15,  20,  20,  15,   0, -30,
+        -30,   5,  10,  15,  15,  10,   5, -30,
+        -40, -20,   0,   5,   5,   0, -20, -40,
+        -50, -40, -30, -30, -30, -30, -40, -50,
+    },
+    { // bishop
+        -20, -10, -10, -10, -10, -10, -10, -20,
+        -10,   0,   0,   0,   0,   0,   0, -10,
+        -10,   0,   5,  10,  10,   5,   0, -10,
+        -10,   5,   5,  10,  10,   5,   5, -10,
+        -10,   0,  10,  10,  10,  10,   0, -10,
+        -10,  10,  10,  10,  10,  10,  10, -10,
+        -10,   5,   0,   0,   0,   0,   5, -10,
+        -20, -10, -10, -10, -10, -10, -10, -20,
+    },
+    { // rook
+          0,   0,   0,   0,   0,   0,   0,   0,
+          5,  10,  10,  10,  10,  10,  10,   5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+          0,   0,   0,   5,   5,   0,   0,   0,
+    },
+    { // queen
+        -20, -10, -10,  -5,  -5, -10, -10, -20,
+        -10,   0,   0,   0,   0,   0,   0, -10,
+        -10,   0,   5,   5,   5,   5,   0, -10,
+         -5,   0,   5,   5,   5,   5,   0,  -5,
+          0,   0,   5,   5,   5,   5,   0,  -5,
+        -10,   5,   5,   5,   5,   5,   0, -10,
+        -10,   0,   5,   0,   0,   0,   0, -10,
+        -20, -10, -10,  -5,  -5, -10, -10, -20,
+    },
+    { // king
+        -30, -40, -40, -50, -50, -40, -40, -30,
+        -30, -40, -40, -50, -50, -40, -40, -30,
+        -30, -40, -40, -50, -50, -40, -40, -30,
+        -30, -40, -40, -50, -50, -40, -40, -30,
+        -20, -30, -30, -40, -40, -30, -30, -20,
+        -10, -20, -20, -20, -20, -20, -20, -10,
+         20,  20,   0,   0,   0,   0,  20,  20,
+         20,  30,  10,   0,   0,  10,  30,  20,
+    },
+};
+
+// Mate scores are stored relative to the node, so a mate found through a transposition keeps its distance.
+int toTable(int score, int ply) {
+    return score > MATE_BOUND ? score + ply : score < -MATE_BOUND ? score - ply : score;
+}
+
+int fromTable(int score, int ply) {
+    return score > MATE_BOUND ? score - ply : score < -MATE_BOUND ? score + ply : score;
+}
+
+int evaluate(const BitBoard &board) {
+    int score = 0;
+    for (int piece = 0; piece < 12; ++piece) {
+        Bitboard squares = board.pieces[piece];
+        int sign = colorOf(piece) == White ? 1 : -1;
+        int flip = colorOf(piece) == White ? 56 : 0;
+        while (squares) {
+            int square = popLsb(squares);
+            score += sign * (PIECE_VALUES[typeOf(piece)] + PIECE_SQUARE[typeOf(piece)][square ^ flip]);
+        }
+    }
+    return board.sideToMove == White ? score : -score;
+}
+
+// Scores each move for ordering: the TT move, captures by MVV-LVA, queen promotions, the two killers,
+// then quiet moves by their history.
+void orderMoves(const BitBoard &board, const MoveList &moves, int16_t *scores, Move ttMove,
+                const std::array<Move, 2> &killers, const std::array<std::array<int16_t, 64>, 64> &history) {
+    for (int i = 0; i < moves.size(); ++i) {
+        Move move = moves[i];
+        int from = moveFrom(move), to = moveTo(move);
+        if (move == ttMove)
+            scores[i] = 30000;
+        else if (isCapture(move)) {
+            int victim = moveFlags(move) == EN_PASSANT ? PAWN : typeOf(board.at(to));
+            scores[i] = 20000 + victim * 8 - typeOf(board.at(from));
+        } else if (isPromotion(move))
+            scores[i] = promotionType(move) == QUEEN ? 19000 : -1000;
+        else if (move == killers[0])
+            scores[i] = 18000;
+        else if (move == killers[1])
+            scores[i] = 17999;
+        else
+            scores[i] = history[from][to];
+    }
+}
+
+// Swaps the best remaining move into position i.
+Move pickMove(MoveList &moves, int16_t *scores, int i) {
+    int best = i;
+    for (int j = i + 1; j < moves.size(); ++j)
+        if (scores[j] > scores[best]) best = j;
+    std::swap(moves.begin()[i], moves.begin()[best]);
+    std::swap(scores[i], scores[best]);
+    return moves[i];
+}
+
+} // namespace
+
+TranspositionTable::TranspositionTable(size_t entries) {
+    size_t size = 1;
+    while (size * 2 <= entries) size *= 2;
+    slots.reset(new Slot[size]);
+    mask = size - 1;
+}
+
+bool TranspositionTable::probe(uint64_t key, TableEntry &entry) const {
+    const Slot &slot = slots[key & mask];
+    uint64_t data = slot.data.load(std::memory_order_relaxed);
+    if ((slot.check.load(std::memory_order_relaxed) ^ data) != key) return false;
+    entry = TableEntry{Move(data), int16_t(data >> 16), uint8_t(data >> 32), uint8_t(data >> 40)};
+    return true;
+}
+
+void TranspositionTable::store(uint64_t key, const TableEntry &entry) {
+    Slot &slot = slots[key & mask];
+    uint64_t data = uint64_t(entry.move) | uint64_t(uint16_t(entry.score)) << 16 | uint64_t(entry.depth) << 32 |
+                    uint64_t(entry.bound) << 40;
+    slot.check.store(key ^ data, std::memory_order_relaxed);
+    slot.data.store(data, std::memory_order_relaxed);
+}
+
+void TranspositionTable::clear() {
+    for (size_t i = 0; i <= mask; ++i) {
+        slots[i].check.store(0, std::memory_order_relaxed);
+        slots[i].data.store(0, std::memory_order_relaxed);
+    }
+}
+
+Search::Search(size_t tableEntries) : table(tableEntries) {
+    workers.emplace_back(new Worker);
+}
+
+void Search::clear() {
+    table.clear();
+    for (auto &worker : workers) {
+        worker->killers = {};
+        worker->history = {};
+    }
+}
+
+bool Search::checkTime(Worker &worker) {
+    if ((++worker.nodes & 2047) == 0) {
+        worker.reportedNodes.store(worker.nodes, std::memory_order_relaxed);
+        if (std::chrono::steady_clock::now() >= deadline) stopped = true;
+    }
+    return stopped.load(std::memory_order_relaxed);
+}
+
+uint64_t Search::totalNodes() const {
+    uint64_t total = workers[0]->nodes;
+    for (size_t i = 1; i < workers.size(); ++i) total += workers[i]->reportedNodes.load(std::memory_order_relaxed);
+    return total;
+}
+
+int Search::quiesce(Worker &worker, int ply, int alpha, int beta) {
+    if (checkTime(worker)) return 0;
+    BitBoard &board = worker.board;
+
+    int standPat = evaluate(board);
+    if (ply >= MAX_PLY - 1 || standPat >= beta) return standPat;
+    alpha = std::max(alpha, standPat);
+
+    MoveList moves;
+    board.legalMoves(board.sideToMove, moves);
+    int16_t scores[MoveList::CAPACITY];
+    orderMoves(board, moves, scores, NO_MOVE, worker.killers[ply], worker.history);
+    for (int i = 0; i < moves.size(); ++i) {
+        Move move = pickMove(moves, scores, i);
+        if (!isCapture(move) && !(isPromotion(move) && promotionType(move) == QUEEN)) break;
+        Undo undo = board.makeMove(move);
+        int score = -quiesce(worker, ply + 1, -beta, -alpha);
+        board.unmakeMove(undo);
+        if (stopped) return 0;
+        if (score >= beta) return score;
+        alpha = std::max(alpha, score);
+    }
+    return alpha;
+}
+
+int Search::negamax(Worker &worker, int depth, int ply, int alpha, int beta) {
+    if (depth <= 0) return quiesce(worker, ply, alpha, beta);
+    if (checkTime(worker)) return 0;
+    BitBoard &board = worker.board;
+
+    uint64_t key = board.hash();
+    worker.keys[ply] = key;
+    if (ply > 0) {
+        if (board.halfmoveClock >= 100) return 0;
+        for (int i = ply - 4; i >= 0 && i >= ply - board.halfmoveClock; i -= 2)
+            if (worker.keys[i] == key) return 0;
+        if (ply >= MAX_PLY - 1) return evaluate(board);
+    }
+
+    TableEntry entry;
+    Move ttMove = NO_MOVE;
+    if (table.probe(key, entry)) {
+        ttMove = entry.move;
+        int score = fromTable(entry.score, ply);
+        if (ply > 0 && entry.depth >= depth &&
+            (entry.bound == EXACT || (entry.bound == LOWER && score >= beta) || (entry.bound == UPPER && score <= alpha)))
+            return score;
+    }
+
+    MoveList moves;
+    board.legalMoves(board.sideToMove, moves);
+    bool inCheck = board.isCheck(board.sideToMove);
+    if (moves.empty()) return inCheck ? -MATE_SCORE + ply : 0;
+    if (inCheck) ++depth;
+
+    int16_t scores[MoveList::CAPACITY];
+    orderMoves(board, moves, scores, ttMove, worker.killers[ply], worker.history);
+    int originalAlpha = alpha;
+    int best = -INFINITE_SCORE;
+    Move bestMove = NO_MOVE;
+    for (int i = 0; i < moves.size(); ++i) {
+        Move move = pickMove(moves, scores, i);
+        Undo undo = board.makeMove(move);
+        int score = -negamax(worker, depth - 1, ply + 1, -beta, -alpha);
+        board.unmakeMove(undo);
+        if (stopped) return 0;
+
+        if (score > best) {
+            best = score;
+            bestMove = move;
+            if (ply == 0) worker.rootBest = move;
+        }
+        alpha = std::max(alpha, score);
+        if (alpha >= beta) {
+            if (!isCapture(move) && !isPromotion(move)) {
+                auto &killers = worker.killers[ply];
+                if (killers[0] != move) killers = {move, killers[0]};
+                int16_t &h = worker.history[moveFrom(move)][moveTo(move)];
+                h = std::min(h + depth * depth, 16000);
+            }
+            break;
+        }
+    }
+
+    uint8_t bound = best >= beta ? LOWER : best > originalAlpha ? EXACT : UPPER;
+    table.store(key, TableEntry{bestMove, int16_t(toTable(best, ply)), uint8_t(depth), bound});
+    return best;
+}
+
+// Iterative deepening for one worker. Only the main worker passes a result; helpers run until stopped
+// and contribute through the table alone.
+void Search::iterate(Worker &worker, const SearchLimits &limits, int firstDepth, SearchResult *result) {
+    for (int depth = firstDepth; depth <= limits.maxDepth && depth < MAX_PLY; ++depth) {
+        worker.rootBest = NO_MOVE;
+        int score = negamax(worker, depth, 0, -INFINITE_SCORE, INFINITE_SCORE);
+        if (!result) {
+            if (stopped) return;
+            continue;
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        result->nodes = totalNodes();
+        result->elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+        if (stopped) {
+            // A partial iteration still searched the previous best move first, so anything it preferred is at least as good.
+            if (worker.rootBest != NO_MOVE) result->best = worker.rootBest;
+            return;
+        }
+        result->best = worker.rootBest;
+        result->score = score;
+        result->depth = depth;
+        if (onIteration) onIteration(*result);
+        // The next iteration costs several times this one; don't start what can't finish.
+        if (elapsed * 2 > std::chrono::milliseconds(limits.timeMs) || std::abs(score) > MATE_BOUND) return;
+    }
+}
+
+SearchResult Search::think(const Board &position, const SearchLimits &limits) {
+    return think(position.engine, limits);
+}
+
+SearchResult Search::think(const BitBoard &position, const SearchLimits &limits) {
+    start = std::chrono::steady_clock::now();
+    deadline = start + std::chrono::milliseconds(limits.timeMs);
+    stopped = false;
+    while (workers.size() < size_t(std::max(1, limits.threads))) workers.emplace_back(new Worker);
+    for (int i = 0; i < std::max(1, limits.threads); ++i) {
+        Worker &worker = *workers[i];
+        worker.board = position;
+        worker.nodes = 0;
+        worker.reportedNodes = 0;
+        worker.killers = {};
+        for (auto &row : worker.history)
+            for (auto &h : row) h /= 8;
+    }
+
+    SearchResult result;
+    MoveList moves;
+    position.legalMoves(position.sideToMove, moves);
+    if (moves.empty()) return result;
+    result.best = moves[0];
+
+    // Lazy SMP: helpers search the same root, half of them one ply deeper, so their table entries are
+    // ready by the time the main worker gets there.
+    std::vector<std::thread> helpers;
+    for (int i = 1; i < limits.threads; ++i)
+        helpers.emplace_back([this, &limits, i] { iterate(*workers[i], limits, 1 + i % 2, nullptr); });
+    iterate(*workers[0], limits, 1, &result);
+    stopped = true;
+    for (auto &helper : helpers) helper.join();
+    result.nodes = workers[0]->nodes;
+    for (int i = 1; i < limits.threads; ++i) result.nodes += workers[i]->nodes;
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    result.elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+    return result;
+}
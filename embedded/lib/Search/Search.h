@@ -0,0 +1,107 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <BitBoard.h>
+#include <Board.h>
+#include <MoveList.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+const int MATE_SCORE = 32000;
+const int MAX_PLY = 64;
+
+struct SearchLimits {
+    uint32_t timeMs = 1000;
+    int maxDepth = MAX_PLY - 1;
+    int threads = 1; // 1 is deterministic; more runs Lazy SMP helpers that only feed the shared table
+};
+
+// The outcome of the deepest completed iteration.
+struct SearchResult {
+    Move best = NO_MOVE;
+    int score = 0; // centipawns for the side to move; |score| > MATE_SCORE - MAX_PLY is a forced mate
+    int depth = 0;
+    uint64_t nodes = 0;
+    uint32_t elapsedMs = 0;
+    uint64_t nodesPerSecond() const { return elapsedMs ? nodes * 1000 / elapsedMs : nodes * 1000; }
+};
+
+enum Bound : uint8_t { EXACT, LOWER, UPPER };
+
+struct TableEntry {
+    Move move;
+    int16_t score;
+    uint8_t depth;
+    uint8_t bound;
+};
+
+// Shared by all search threads without locks. Each slot stores its packed data next to key ^ data, so a
+// slot torn by two threads writing at once no longer matches any key and reads as a miss.
+class TranspositionTable {
+public:
+    explicit TranspositionTable(size_t entries);
+    bool probe(uint64_t key, TableEntry &entry) const;
+    void store(uint64_t key, const TableEntry &entry);
+    void clear();
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> check{0};
+        std::atomic<uint64_t> data{0};
+    };
+    std::unique_ptr<Slot[]> slots;
+    size_t mask;
+};
+
+// Negamax alpha-beta with iterative deepening, quiescence on captures, a transposition table and
+// TT move / MVV-LVA / killer / history move ordering. Each ply keeps its MoveList on the stack, so the
+// calling task needs roughly 1 KB of stack per ply of depth on the ESP32.
+class Search {
+public:
+#ifdef ARDUINO
+    static const size_t DEFAULT_TABLE_ENTRIES = 1 << 12; // 64 KB
+#else
+    static const size_t DEFAULT_TABLE_ENTRIES = 1 << 22; // 64 MB
+#endif
+
+    explicit Search(size_t tableEntries = DEFAULT_TABLE_ENTRIES);
+
+    SearchResult think(const Board &board, const SearchLimits &limits);
+    SearchResult think(const BitBoard &position, const SearchLimits &limits);
+    void stop() { stopped = true; }
+    void clear();
+
+    // Called after every completed iteration, e.g. to print depth, score and nodes/sec.
+    std::function<void(const SearchResult &)> onIteration;
+
+private:
+    // Everything one search thread owns. Workers outlive a single think() so the history table carries over.
+    struct Worker {
+        BitBoard board;
+        std::array<std::array<Move, 2>, MAX_PLY> killers{};
+        std::array<std::array<int16_t, 64>, 64> history{};
+        std::array<uint64_t, MAX_PLY> keys{};
+        uint64_t nodes = 0;
+        std::atomic<uint64_t> reportedNodes{0}; // nodes as of the last time check, for the main thread to sum
+        Move rootBest = NO_MOVE;
+    };
+
+    void iterate(Worker &worker, const SearchLimits &limits, int firstDepth, SearchResult *result);
+    int negamax(Worker &worker, int depth, int ply, int alpha, int beta);
+    int quiesce(Worker &worker, int ply, int alpha, int beta);
+    bool checkTime(Worker &worker);
+    uint64_t totalNodes() const;
+
+    TranspositionTable table;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point deadline;
+    std::atomic<bool> stopped{false};
+};
+
+#endif
@@ -6,9 +6,15 @@
 #include <BLEUtils.h>
 #include <BiMap.h>
 #include <Board.h>
+#include <CncMovePlanner.h>
 #include <ESP32Servo.h>
+#include <GrblController.h>
 #include <MFRC522.h>
+#include <MotionProfile.h>
+#include <ReaderHealth.h>
+#include <ReaderSelect.h>
 #include <SPI.h>
+#include <ScanScheduler.h>
 #include <Wire.h>
 // RFID
 #define RST_PIN 5
@@ -26,23 +32,48 @@ Servo myServo;
 const int SERVO_PIN = 8;
 // GRBL over UART
 HardwareSerial &grbl = Serial1;
+
+class SerialLink : public GrblLink {
+public:
+    explicit SerialLink(Stream &stream) : stream(stream) {}
+    int available() override { return stream.available(); }
+    int read() override { return stream.read(); }
+    void write(const char *data, size_t length) override { stream.write(reinterpret_cast<const uint8_t *>(data), length); }
+
+private:
+    Stream &stream;
+};
+
+SerialLink grblLink(grbl);
+GrblController cnc(grblLink);  // only touched from the command task
+CncMovePlanner movePlanner;    // likewise; remembers the graveyard slots. A promoting pawn goes up itself,
+                               // since boardState couldn't follow a piece swapped in from the graveyard
+MotionProfiles motionProfiles; // feed rates per piece type, one acceleration for the gantry
+std::deque<std::string> queuedMoves; // move_cnc commands waiting for the gantry; command task only
+bool moveRunning = false;
+// The board a finished move left, for the move queued straight behind it: the readers and the app's
+// move_ack haven't caught up with the first move by the time the second is planned.
+std::optional<BitBoard> boardAfterMove;
 const int GRBL_RX = 6;
 const int GRBL_TX = 7;
 // BLE UUIDs
 #define SERVICE_UUID "0000180C-0000-1000-8000-00805F9B34FB"
 #define CHARACTERISTIC_UUID "00002A56-0000-1000-8000-00805F9B34FB"
 // State
-bool deviceConnected = false;
+volatile bool deviceConnected = false;
 BLECharacteristic *statusChar = nullptr;
 MFRC522 mfrc522(SS_PIN, RST_PIN);
 Adafruit_NeoPixel strip(NUM_PIXELS, DATA_PIN, NEO_GRB + NEO_KHZ800);
 // Board state
 const int numReaders = 64;
-bool gameReady = false;
-bool hasNotifiedReady = false;
-bool gameStarted = false;
+volatile bool gameReady = false;
+volatile bool hasNotifiedReady = false;
+volatile bool gameStarted = false;
 BiMap<std::string, XYPos> boardState; // byte to chess id
 std::string hovering;
+std::unordered_map<std::string, PieceType> promotedUids; // pawns the gantry promoted, which keep their tags
+ScanScheduler scanScheduler; // scan task only
+ReaderHealth readerHealth;   // guarded by stateMutex; reported by reader_health
 // White Pieces
 std::set<std::string> whitePawnUIDs = {"1D0BDB5D0D1080", "1D0CDB5D0D1080", "1D0DDB5D0D1080", "1D0EDB5D0D1080", "1D9BDB5D0D1080", "1DA7DA5D0D1080", "1DA8DA5D0D1080", "1DAADA5D0D1080"};
 std::set<std::string> whiteRookUIDs = {"1DA0DA5D0D1080", "1DA6DA5D0D1080"};
@@ -59,14 +90,37 @@ std::set<std::string> blackQueenUIDs = {"1D18DB5D0D1080"};
 std::set<std::string> blackKingUIDs = {"1D1BDB5D0D1080"};
 
 // FreeRTOS
+// The scan task owns the RFID readers on the app core. The command task owns GRBL and the servo on the
+// protocol core and works through writeQueue, so BLE callbacks only ever enqueue.
 #define WRITE_QUEUE_LEN 10
-#define WRITE_MSG_LEN 64
+#define WRITE_MSG_LEN 72 // the longest command, light_on:<square><27 queen targets>, is 65 characters
+#define SCAN_CORE 1
+#define COMMAND_CORE 0
+#define TASK_STACK 8192
 QueueHandle_t writeQueue;
+SemaphoreHandle_t stateMutex; // guards boardState, hovering and the LED strip across both tasks
 
 struct WriteMessage {
     char msg[WRITE_MSG_LEN];
 };
 
+struct StateLock {
+    StateLock() { xSemaphoreTake(stateMutex, portMAX_DELAY); }
+    ~StateLock() { xSemaphoreGive(stateMutex); }
+};
+
+// Never blocks: a full queue drops the command rather than stalling the BLE stack. A command too long to
+// queue is dropped too; acting on a truncated one would light or move the wrong squares.
+void enqueueCommand(const std::string &command) {
+    if (command.size() >= WRITE_MSG_LEN) {
+        Serial.println(("Command too long, dropped " + command).c_str());
+        return;
+    }
+    WriteMessage message = {};
+    strncpy(message.msg, command.c_str(), WRITE_MSG_LEN - 1);
+    if (xQueueSend(writeQueue, &message, 0) != pdTRUE) Serial.println(("Command queue full, dropped " + command).c_str());
+}
+
 // === Start animation helpers ===
 const float CENTER_X = (WIDTH - 1) / 2.0;
 const float CENTER_Y = (HEIGHT - 1) / 2.0;
@@ -116,42 +170,36 @@ void drawRadiatingWaveFrame() {
     waveRadius += speed;
 }
 // === Pin helpers ===
-void sendBit(int val) {
-    digitalWrite(SER, val);
-    digitalWrite(CLK, LOW);
-    digitalWrite(CLK, HIGH);
-}
-
-void sendByte(uint8_t val, int order) {
-    for (int i = 0; i < 8; i++) {
-        if (order == MSBFIRST) {
-            sendBit((val & 128) != 0);
-            val <<= 1;
-        } else {
-            sendBit((val & 1) != 0);
-            val >>= 1;
-        }
+// The reader-select chain on the second SPI host, SER as MOSI and CLK as SCK. The registers clock on the
+// rising edge and have no latch, so mode 0 and no chip select; the MFRC522s keep the default SPI bus.
+class SpiShiftChain : public ShiftChain {
+public:
+    void begin() { spi.begin(CLK, -1, SER, -1); }
+
+    void write(const uint8_t *bytes, size_t count) override {
+        spi.beginTransaction(settings);
+        spi.writeBytes(bytes, count);
+        spi.endTransaction();
     }
-}
 
-void activateReader(int readerIndex) {
-    const int totalRegisters = 8; // 8 shift registers
-    uint8_t bytes[totalRegisters] = {0};
+    void clockZeros(int count) override {
+        spi.beginTransaction(settings);
+        spi.transferBits(0, nullptr, count);
+        spi.endTransaction();
+    }
 
-    // Set the correct bit in the corresponding register
-    int reg = readerIndex / 8;
-    int bit = readerIndex % 8;
-    bytes[reg] = 1 << bit;
+private:
+    SPIClass spi{HSPI};
+    SPISettings settings{8000000, MSBFIRST, SPI_MODE0};
+};
 
-    // Shift out the entire register chain
-    for (int i = totalRegisters - 1; i >= 0; i--) {
-        sendByte(bytes[i], MSBFIRST);
-    }
-}
+SpiShiftChain readerChain;
+ReaderSelect readerSelect(readerChain); // scan task only
 
 void clearRegisters() {
     digitalWrite(CLR, LOW);
     digitalWrite(CLR, HIGH);
+    readerSelect.forget();
 }
 
 std::string uidToString(const MFRC522::Uid &uid) {
@@ -170,99 +218,247 @@ XYPos readerToXYPos(int readerIndex) {
     return XYPos(x, y);
 }
 
+int xyPosToReader(const XYPos &pos) {
+    return (pos.y - 1) * 8 + static_cast<int>(pos.x) - 1;
+}
+
 int stringPosToIndex(const std::string &pos) {
     int file = pos[0] - 'a';
     int rank = pos[1] - '1';
     return rank * 8 + file;
 }
 
-std::string stringPosToGcode(const std::string &pos, int feedRate = 6000) {
-    int file = pos[0] - 'a';
-    int rank = pos[1] - '1';
-    return "G0 X" + std::to_string(file * 60 + 30) + " Y" + std::to_string(rank * 60 + 30) + " F" + std::to_string(feedRate);
+// The piece code for a tag, or EMPTY_SQUARE for one that belongs to no piece.
+uint8_t pieceForUid(const std::string &uid) {
+    auto promoted = promotedUids.find(uid);
+    if (promoted != promotedUids.end()) return makePiece(whitePawnUIDs.count(uid) ? White : Black, promoted->second);
+    const std::set<std::string> *uids[2][6] = {
+        {&blackPawnUIDs, &blackKnightUIDs, &blackBishopUIDs, &blackRookUIDs, &blackQueenUIDs, &blackKingUIDs},
+        {&whitePawnUIDs, &whiteKnightUIDs, &whiteBishopUIDs, &whiteRookUIDs, &whiteQueenUIDs, &whiteKingUIDs}};
+    for (int color = 0; color < 2; color++) {
+        for (int type = 0; type < 6; type++) {
+            if (uids[color][type]->count(uid)) return makePiece(Color(color), PieceType(type));
+        }
+    }
+    return EMPTY_SQUARE;
 }
 
-void scanBoard() {
-    for (int i = 0; i < numReaders; i++) {
-        clearRegisters();
-        activateReader(i);
-        delayMicroseconds(1000);
-        mfrc522.PCD_Init();
-        mfrc522.PCD_SetAntennaGain(mfrc522.RxGain_max);
-        XYPos currentPos = readerToXYPos(i);
-        String message;
-
-        byte v = mfrc522.PCD_ReadRegister(mfrc522.VersionReg);
-        if (!mfrc522.PCD_PerformSelfTest() || v == 0x00 || v == 0xFF) {
-            Serial.println("Error at " + currentPos.toString());
-            clearRegisters();
-            activateReader(i);
-            mfrc522.PCD_Init();
-            mfrc522.PCD_SetAntennaGain(mfrc522.RxGain_max);
-            v = mfrc522.PCD_ReadRegister(mfrc522.VersionReg);
-        }
+// The pieces where the readers last saw them.
+BitBoard physicalPosition() {
+    StateLock lock;
+    BitBoard position;
+    for (const auto &entry : boardState.forward) {
+        uint8_t piece = pieceForUid(entry.first);
+        if (piece != EMPTY_SQUARE) position.put(piece, xyPosToReader(entry.second));
+    }
+    return position;
+}
+
+// The servo is still travelling until servoSettledAt; the command task runs afterServo once it has arrived.
+uint32_t servoSettledAt = 0;
+std::function<void()> afterServo;
+
+void moveServo(int angle, uint32_t settleMs, std::function<void()> then) {
+    myServo.write(angle);
+    servoSettledAt = millis() + settleMs;
+    afterServo = std::move(then);
+}
 
-        if (mfrc522.PICC_IsNewCardPresent() && mfrc522.PICC_ReadCardSerial()) { // is there a piece on this square?
-            std::string uid = uidToString(mfrc522.uid);
-            if (!boardState.containsUid(uid)) {
-                strip.setPixelColor(i, strip.Color(255, 0, 0));
+// Plays the legs in turn: travel to the pick-up point with the magnet down, engage, stream the carried
+// route as one program, release. Each step continues from onIdle or once the servo has settled, so the
+// command task never blocks, and every leg starts with GRBL idle, which is when the acceleration can be
+// set; it only reaches GRBL's EEPROM the first time, or again if GRBL rejected it.
+void runLegs(std::shared_ptr<std::vector<CncLeg>> legs, size_t i, std::function<void()> done) {
+    if (i == legs->size()) {
+        done();
+        return;
+    }
+    Waypoint pickUp = (*legs)[i].path.front();
+    std::string program = motionProfiles.program((*legs)[i]);
+    cnc.setAcceleration(motionProfiles.acceleration);
+    cnc.moveTo(pickUp.x, pickUp.y, motionProfiles.travelFeedRate);
+    cnc.onIdle([legs, i, done, program] {
+        moveServo(120, 250, [legs, i, done, program] { // Engage magnet
+            cnc.send(program);
+            cnc.onIdle([legs, i, done] {
+                moveServo(0, 150, [legs, i, done] { runLegs(legs, i + 1, done); }); // Disengage magnet
+            });
+        });
+    });
+}
+
+// One register read in place of the version read and self-test: a reader that was reset reads back the
+// default gain, and a dead one reads 0x00 or 0xFF.
+bool readerConfigured() {
+    byte v = mfrc522.PCD_ReadRegister(mfrc522.RFCfgReg);
+    return v != 0xFF && (v & (0x07 << 4)) == mfrc522.RxGain_max;
+}
+
+// Selects reader i and initialises it if it needs it. False if the reader isn't working; don't trust an
+// empty read from it.
+bool selectReader(int i) {
+    readerSelect.select(i);
+    delayMicroseconds(1000);
+    uint32_t now = millis();
+    bool needsInit;
+    {
+        StateLock lock;
+        readerHealth.polled(i);
+        needsInit = readerHealth.needsInit(i, now);
+    }
+    if (!needsInit) {
+        if (readerConfigured()) return true;
+        StateLock lock;
+        readerHealth.lost(i);
+    }
+
+    mfrc522.PCD_Init();
+    mfrc522.PCD_SetAntennaGain(mfrc522.RxGain_max);
+    bool ok = readerConfigured();
+    {
+        StateLock lock;
+        readerHealth.initialized(i, now, ok);
+    }
+    if (!ok) Serial.println("Error at " + readerToXYPos(i).toString());
+    return ok;
+}
+
+// Reads one square and reports what changed to the app. Returns true if the square changed.
+bool pollSquare(int i) {
+    if (!selectReader(i)) return false;
+    XYPos currentPos = readerToXYPos(i);
+    String message;
+
+    bool present = mfrc522.PICC_IsNewCardPresent() && mfrc522.PICC_ReadCardSerial();
+    std::string uid = present ? uidToString(mfrc522.uid) : "";
+    bool known;
+    {
+        StateLock lock;
+        known = boardState.containsUid(uid);
+    }
+    if (present && !known) {
+        // Only the LED updates hold the lock, so the command task keeps running while we wait.
+        {
+            StateLock lock;
+            strip.setPixelColor(i, strip.Color(255, 0, 0));
+            strip.show();
+        }
+        while (true) {
+            Serial.println("Error please remove this peice from the square it shouldnt be on the board");
+            bool removed = !mfrc522.PICC_ReadCardSerial() && !mfrc522.PICC_ReadCardSerial();
+            if (removed) {
+                StateLock lock;
+                strip.setPixelColor(i, strip.Color(0, 0, 0));
                 strip.show();
-                while (true) {
-                    Serial.println("Error please remove this peice from the square it shouldnt be on the board");
-                    bool removed = !mfrc522.PICC_ReadCardSerial() && !mfrc522.PICC_ReadCardSerial();
-                    if (removed) {
-                        strip.setPixelColor(i, strip.Color(0, 0, 0));
-                        strip.show();
-                        break;
-                    }
-                }
-            } else if (boardState.containsXYPos(currentPos)) {           // was there a piece on this square before?
-                if (boardState.getFromXYPos(currentPos) != uid) {        // did the piece on this square a different uid?
-                    String from = boardState.getFromUid(uid).toString(); // attacker's origin
-                    String to = currentPos.toString();                   // capture destination
-                    String message = "capture:" + from + to;
-                    statusChar->setValue(message.c_str());
-                    statusChar->notify();
-                    Serial.println("Message sent" + message);
-                } else {
-                    // nothing to do the piece was in the same position
-                    if (hovering == uid) {
-                        // if the piece was hovering mark as no longer hovering
-                        hovering = "";
-                        statusChar->setValue("clear");
-                        statusChar->notify();
-                        Serial.println("Undoing hovering at " + currentPos.toString());
-                    }
-                }
+                break;
+            }
+        }
+        return true;
+    }
 
-            } else {
-                // move
-                message = "move:" + boardState.getFromUid(uid).toString() + currentPos.toString();
+    StateLock lock;
+    if (present) { // is there a piece on this square?
+        if (boardState.containsXYPos(currentPos)) {                  // was there a piece on this square before?
+            if (boardState.getFromXYPos(currentPos) != uid) {        // did the piece on this square a different uid?
+                String from = boardState.getFromUid(uid).toString(); // attacker's origin
+                String to = currentPos.toString();                   // capture destination
+                String message = "capture:" + from + to;
                 statusChar->setValue(message.c_str());
                 statusChar->notify();
-                Serial.println("Message sent " + message);
+                Serial.println("Message sent" + message);
+                return true;
+            } else {
+                // nothing to do the piece was in the same position
+                if (hovering == uid) {
+                    // if the piece was hovering mark as no longer hovering
+                    hovering = "";
+                    statusChar->setValue("clear");
+                    statusChar->notify();
+                    Serial.println("Undoing hovering at " + currentPos.toString());
+                    return true;
+                }
             }
+
         } else {
-            if (boardState.containsXYPos(currentPos) && hovering == "") {
-                // hover
-                message = "hover:" + currentPos.toString();
-                statusChar->setValue(message.c_str());
-                statusChar->notify();
-                hovering = boardState.getFromXYPos(currentPos);
-                Serial.println(message);
-            }
+            // move
+            message = "move:" + boardState.getFromUid(uid).toString() + currentPos.toString();
+            statusChar->setValue(message.c_str());
+            statusChar->notify();
+            Serial.println("Message sent " + message);
+            return true;
+        }
+    } else {
+        if (boardState.containsXYPos(currentPos) && hovering == "") {
+            // hover
+            message = "hover:" + currentPos.toString();
+            statusChar->setValue(message.c_str());
+            statusChar->notify();
+            hovering = boardState.getFromXYPos(currentPos);
+            Serial.println(message);
+            return true;
         }
     }
+    return false;
 }
 
+// Where the next change will show up: the lifted piece's origin and legal destinations, or every piece
+// that has a legal move while nothing is lifted. Castling rights aren't known from the tags alone, so a
+// lifted king also expects the squares two files away.
+uint64_t expectedChanges() {
+    BitBoard position = physicalPosition();
+    int origin = -1;
+    {
+        StateLock lock;
+        if (!hovering.empty() && boardState.containsUid(hovering)) origin = xyPosToReader(boardState.getFromUid(hovering));
+    }
+    if (origin >= 0) {
+        Bitboard squares = squareBit(origin) | position.legalTargets(origin);
+        if (typeOf(position.at(origin)) == KING) {
+            if (fileOf(origin) >= 2) squares |= squareBit(origin - 2);
+            if (fileOf(origin) <= 5) squares |= squareBit(origin + 2);
+        }
+        return squares;
+    }
+    Bitboard movable = 0;
+    for (Bitboard pieces = position.occupied(); pieces;) {
+        int square = popLsb(pieces);
+        if (position.legalTargets(square)) movable |= squareBit(square);
+    }
+    return movable;
+}
+
+// Polls a batch of the readers the scheduler picks, refreshing the expected squares whenever one changes
+// and at the start of every batch, since commands from the app also move pieces.
+void scanBoard() {
+    scanScheduler.setHot(expectedChanges());
+    for (int n = 0; n < 8; n++) {
+        int i = scanScheduler.next(millis());
+        if (pollSquare(i)) {
+            scanScheduler.changed(i, millis());
+            scanScheduler.setHot(expectedChanges());
+        }
+    }
+}
+
+// Runs on the command task, which owns the servo and GRBL.
 void resetBoard() {
     myServo.write(0);
+    afterServo = nullptr;
     delay(50);
-    grbl.println("$H");
+    // Drop the rest of any move in progress; home once the lines GRBL already has are done.
+    cnc.clear();
+    cnc.onIdle([] { cnc.send("$H"); });
+    queuedMoves.clear();
+    moveRunning = false;
+    boardAfterMove.reset();
+    movePlanner.clear();
     gameReady = false;
     hasNotifiedReady = false;
     gameStarted = false;
+    StateLock lock;
     boardState.clear();
+    promotedUids.clear();
+    hovering = "";
     strip.clear();
     strip.show();
     Serial.println("Reseting board state");
@@ -273,14 +469,22 @@ void initializeBoard() {
     Serial.println("Waiting for all 32 pieces to be placed in their correct starting positions.");
 
     // Light up all valid starting squares in green
-    for (int i = 0; i < 16; i++) {
-        strip.setPixelColor(i, strip.Color(0, 255, 0));      // Ranks 1 & 2
-        strip.setPixelColor(i + 48, strip.Color(0, 255, 0)); // Ranks 7 & 8
+    {
+        StateLock lock;
+        for (int i = 0; i < 16; i++) {
+            strip.setPixelColor(i, strip.Color(0, 255, 0));      // Ranks 1 & 2
+            strip.setPixelColor(i + 48, strip.Color(0, 255, 0)); // Ranks 7 & 8
+        }
+        strip.show();
     }
-    strip.show();
 
     while (true) {
-        bool allPiecesCorrectlyPlaced = boardState.forward.size() == 32 && invalidPlacementIndexes.empty();
+        bool allPiecesCorrectlyPlaced;
+        {
+            StateLock lock;
+            allPiecesCorrectlyPlaced = boardState.forward.size() == 32 && invalidPlacementIndexes.empty();
+        }
+        if (!deviceConnected) return; // the app went away while we were waiting
 
         if (allPiecesCorrectlyPlaced) {
             Serial.println("Initial board setup complete and valid!");
@@ -289,10 +493,14 @@ void initializeBoard() {
             for (int cycle = 0; cycle < 2; cycle++) {
                 waveRadius = 0.0;
                 while (waveRadius <= maxDist + widthBand) {
-                    drawRadiatingWaveFrame();
+                    {
+                        StateLock lock;
+                        drawRadiatingWaveFrame();
+                    }
                     delay(10);
                 }
             }
+            StateLock lock;
             strip.clear();
             strip.show();
             break; // Exit the while loop
@@ -300,16 +508,14 @@ void initializeBoard() {
 
         // Scan each square on the board
         for (int i = 0; i < numReaders; i++) {
-            clearRegisters();
-            activateReader(i);
-            delayMicroseconds(1000);
-
-            mfrc522.PCD_Init();
+            if (!selectReader(i)) continue;
 
             XYPos currentPos = readerToXYPos(i);
 
             // Check if a piece is present on the current square
-            if (mfrc522.PICC_IsNewCardPresent() && mfrc522.PICC_ReadCardSerial()) {
+            bool present = mfrc522.PICC_IsNewCardPresent() && mfrc522.PICC_ReadCardSerial();
+            StateLock lock;
+            if (present) {
                 std::string uid = uidToString(mfrc522.uid);
                 bool isPositionValidForPiece = false;
 
@@ -393,7 +599,7 @@ class ServerCallbacks : public BLEServerCallbacks {
     void onDisconnect(BLEServer *pServer) override {
         deviceConnected = false;
         Serial.println("BLE client disconnected");
-        resetBoard();
+        enqueueCommand("reset");
         BLEDevice::startAdvertising(); // Restart advertising
     }
 };
@@ -401,140 +607,230 @@ class ServerCallbacks : public BLEServerCallbacks {
 class StatusCharCallback : public BLECharacteristicCallbacks {
     void onWrite(BLECharacteristic *pCharacteristic) override {
         std::string value = pCharacteristic->getValue();
-        if (value.length() > 0) {
-            Serial.print("BLE received: ");
-            if (!gameStarted && value == "start_confirmed") {
-                Serial.println("Game start confirmed by app!");
-                gameStarted = true;
-
-            } else if (value.rfind("clear_piece", 0) == 0) {
-                std::string lights = value.substr(9);
-                for (int i = 0; i < lights.size(); i += 2) {
-                    int index = stringPosToIndex(lights.substr(i, 2));
-                    if (boardState.containsXYPos(readerToXYPos(index))) {
-                        strip.setPixelColor(index, strip.Color(0, 0, 255));
-                        strip.show();
-                    }
-                }
+        if (value.length() > 0) enqueueCommand(value);
+    }
+};
+
+void startNextMove();
+
+void finishMove(std::optional<BitBoard> after = std::nullopt) {
+    moveRunning = false;
+    boardAfterMove = queuedMoves.empty() ? std::nullopt : after;
+    startNextMove();
+}
+
+// e2e4, or e7e8q naming the promotion piece. Captures, castling and en passant are read off the board, so
+// one command plays the whole move.
+void playMove(const std::string &uci) {
+    int from = stringPosToIndex(uci.substr(0, 2));
+    int to = stringPosToIndex(uci.substr(2, 2));
+    size_t promotion = uci.size() > 4 ? std::string("nbrq").find(uci[4]) : std::string::npos;
+    BitBoard position = boardAfterMove ? *boardAfterMove : physicalPosition();
+    boardAfterMove.reset();
+    if (position.at(from) == EMPTY_SQUARE) {
+        Serial.println(("No piece to move on " + uci.substr(0, 2)).c_str());
+        finishMove();
+        return;
+    }
+    Move move = CncMovePlanner::inferMove(position, from, to, promotion == std::string::npos ? QUEEN : PieceType(KNIGHT + promotion));
+    auto legs = std::make_shared<std::vector<CncLeg>>(movePlanner.plan(position, move, {cnc.status().x, cnc.status().y}));
+    Serial.println(("Playing " + moveToUci(move) + " in " + std::to_string(legs->size()) + " legs").c_str());
+    myServo.write(0);
+    BitBoard after = position;
+    after.makeMove(move);
+    std::string promotedUid;
+    if (isPromotion(move)) {
+        StateLock lock;
+        if (boardState.containsXYPos(readerToXYPos(from))) promotedUid = boardState.getFromXYPos(readerToXYPos(from));
+    }
+    // boardState follows the app's move_ack/capture_ack for every piece the move touched, castling rook
+    // and en passant victim included.
+    cnc.onIdle([legs, after, move, promotedUid] {
+        runLegs(legs, 0, [after, move, promotedUid] {
+            if (!promotedUid.empty()) {
+                StateLock lock;
+                promotedUids[promotedUid] = promotionType(move);
             }
+            finishMove(after);
+        });
+    });
+}
 
-            else if (value.rfind("move_cnc:", 0) == 0) {
-                myServo.write(0);
-                delay(150);
-                std::string from = value.substr(9, 2);
-                std::string to = value.substr(11, 2);
-                grbl.println(stringPosToGcode(from, 120000).c_str());
-                delay(50);
-                Serial.println("Moving to 'from' position: " + String(from.c_str()));
-
-                // Wait for the 'from' move to complete
-                while (true) {
-                    grbl.println("?"); // Ask GRBL for its status
-
-                    // Check if there's a response from GRBL
-                    if (grbl.available()) {
-                        String resp = grbl.readStringUntil('\n');
-                        Serial.println("GRBL Status: " + resp);
-
-                        // Correctly check if the response contains "Idle"
-                        if (resp.indexOf("Idle") > 0) {
-                            delay(1500);
-                            Serial.println("Arrived at 'from' position. Engaging magnet.");
-                            myServo.write(120); // Engage magnet←
-                            delay(250);
-                            break; // Exit this loop and proceed to the next move
-                        }
-                    }
-                }
+// The gantry plays one move at a time. A move_cnc that arrives mid-move waits here, and is only planned,
+// and the magnet only touched, once the move before it has finished.
+void startNextMove() {
+    if (moveRunning || queuedMoves.empty()) return;
+    std::string uci = queuedMoves.front();
+    queuedMoves.pop_front();
+    moveRunning = true;
+    playMove(uci);
+}
 
-                // --- Move to the 'to' position ---
-                grbl.println(stringPosToGcode(to, 2000).c_str());
-                delay(50);
-                Serial.println("Moving to 'to' position: " + String(to.c_str()));
-
-                // Wait for the 'to' move to complete
-                while (true) {
-                    grbl.println("?"); // Ask GRBL for its status
-                    if (grbl.available()) {
-                        String resp = grbl.readStringUntil('\n');
-                        Serial.println("GRBL Status: " + resp);
-
-                        // Correctly check if the response contains "Idle"
-                        if (resp.indexOf("Idle") > 0) {
-                            delay(1500);
-                            myServo.write(0); // Disengage magnet
-                            delay(150);
-                            Serial.println("Arrived at 'to' position. Disengaging magnet.");
-                            break; // Exit this loop, the full move is complete
-                        }
-                    }
-                }
-            } else if (value.rfind("move_ack:", 0) == 0) {
-                std::string from = value.substr(9, 2);
-                std::string to = value.substr(11, 2);
-                std::string uid = boardState.getFromXYPos(XYPos(from));
-                boardState.eraseByXYPos(from);
-                boardState.insert(uid, XYPos(to));
-                hovering = "";
-
-            } else if (value.rfind("capture_ack:", 0) == 0) {
-                std::string move = value.substr(12);
-                std::string from = move.substr(0, 2);
-                std::string to = move.substr(2, 2);
-                std::string uid_captured = boardState.getFromXYPos(XYPos(to));
-                std::string uid = boardState.getFromXYPos(XYPos(from));
-                boardState.eraseByUid(uid_captured);
-                hovering = "";
-                boardState.eraseByXYPos(from);
-                boardState.insert(uid, XYPos(to));
-                Serial.println(("Capture ACK processed: " + from + " -> " + to).c_str());
-
-            } else if (value == "game_ended") {
-                resetBoard();
-                delay(100);
-                statusChar->setValue("connected");
+// Everything the app writes, plus the internal "reset" and "ready" commands, handled in order on the command task.
+void handleCommand(const std::string &value) {
+    if (value.length() > 0) {
+        Serial.print("BLE received: ");
+        if (value == "reset") {
+            resetBoard();
+
+        } else if (value == "ready") {
+            myServo.write(0);
+            delay(50);
+            cnc.send("$X");
+            cnc.send("$H");
+            cnc.onIdle([] {
+                statusChar->setValue("ready_to_start");
                 statusChar->notify();
-
-            } else if (value.rfind("light_on", 0) == 0) {
-                Serial.println(value.c_str());
-                // std::string ackMessage = "ack:" + value;
-                // statusChar->setValue(ackMessage.c_str());
-                // statusChar->notify();
-                std::string lights = value.substr(9);
-                for (int i = 0; i < lights.size(); i += 2) {
-                    int index = stringPosToIndex(lights.substr(i, 2));
-                    if (i != 0 && boardState.containsXYPos(readerToXYPos(index)))
-                        strip.setPixelColor(index, strip.Color(255, 0, 0));
-                    else
-                        strip.setPixelColor(index, strip.Color(0, 255, 0));
+                Serial.println("Notified app: ready_to_start");
+            });
+
+        } else if (!gameStarted && value == "start_confirmed") {
+            Serial.println("Game start confirmed by app!");
+            gameStarted = true;
+
+        } else if (value.rfind("clear_piece", 0) == 0) {
+            std::string lights = value.substr(9);
+            StateLock lock;
+            for (int i = 0; i < lights.size(); i += 2) {
+                int index = stringPosToIndex(lights.substr(i, 2));
+                if (boardState.containsXYPos(readerToXYPos(index))) {
+                    strip.setPixelColor(index, strip.Color(0, 0, 255));
+                    strip.show();
                 }
-                strip.show();
+            }
+        }
 
-            } else if (value == "light_off") {
-                Serial.println(value.c_str());
-                // std::string ackMessage = "ack:" + value;
-                // statusChar->setValue(ackMessage.c_str());
-                // statusChar->notify();
-                strip.clear();
-                strip.show();
-            } else if (value.rfind("in_check", 0) == 0) {
-                int index = stringPosToIndex(value.substr(9, 2));
-                strip.setPixelColor(index, strip.Color(255, 0, 0));
-                strip.show();
+        else if (value.rfind("move_cnc:", 0) == 0) {
+            queuedMoves.push_back(value.substr(9));
+            startNextMove();
+        } else if (value.rfind("move_ack:", 0) == 0) {
+            std::string from = value.substr(9, 2);
+            std::string to = value.substr(11, 2);
+            StateLock lock;
+            hovering = "";
+            if (!boardState.containsXYPos(XYPos(from))) {
+                Serial.println(("Nothing on " + from + " to move, ignoring " + value).c_str());
+                return;
+            }
+            std::string uid = boardState.getFromXYPos(XYPos(from));
+            boardState.eraseByXYPos(from);
+            boardState.insert(uid, XYPos(to));
+
+        } else if (value.rfind("capture_ack:", 0) == 0) {
+            std::string move = value.substr(12);
+            std::string from = move.substr(0, 2);
+            std::string to = move.substr(2, 2);
+            StateLock lock;
+            hovering = "";
+            if (!boardState.containsXYPos(XYPos(from)) || !boardState.containsXYPos(XYPos(to))) {
+                Serial.println(("Capture already recorded, ignoring " + value).c_str());
+                return;
+            }
+            std::string uid_captured = boardState.getFromXYPos(XYPos(to));
+            std::string uid = boardState.getFromXYPos(XYPos(from));
+            boardState.eraseByUid(uid_captured);
+            boardState.eraseByXYPos(from);
+            boardState.insert(uid, XYPos(to));
+            Serial.println(("Capture ACK processed: " + from + " -> " + to).c_str());
+
+        } else if (value == "game_ended") {
+            resetBoard();
+            delay(100);
+            statusChar->setValue("connected");
+            statusChar->notify();
+
+        } else if (value.rfind("light_on", 0) == 0) {
+            Serial.println(value.c_str());
+            // std::string ackMessage = "ack:" + value;
+            // statusChar->setValue(ackMessage.c_str());
+            // statusChar->notify();
+            std::string lights = value.substr(9);
+            StateLock lock;
+            for (int i = 0; i < lights.size(); i += 2) {
+                int index = stringPosToIndex(lights.substr(i, 2));
+                if (i != 0 && boardState.containsXYPos(readerToXYPos(index)))
+                    strip.setPixelColor(index, strip.Color(255, 0, 0));
+                else
+                    strip.setPixelColor(index, strip.Color(0, 255, 0));
+            }
+            strip.show();
+
+        } else if (value == "light_off") {
+            Serial.println(value.c_str());
+            // std::string ackMessage = "ack:" + value;
+            // statusChar->setValue(ackMessage.c_str());
+            // statusChar->notify();
+            StateLock lock;
+            strip.clear();
+            strip.show();
+        } else if (value == "reader_health") {
+            std::string report;
+            {
+                StateLock lock;
+                report = "reader_health:" + readerHealth.report();
             }
+            statusChar->setValue(report.c_str());
+            statusChar->notify();
+            Serial.println(report.c_str());
+
+        } else if (value.rfind("in_check", 0) == 0) {
+            int index = stringPosToIndex(value.substr(9, 2));
+            StateLock lock;
+            strip.setPixelColor(index, strip.Color(255, 0, 0));
+            strip.show();
         }
     }
-};
+}
+
+void scanTask(void *) {
+    while (true) {
+        if (!deviceConnected) {
+            vTaskDelay(pdMS_TO_TICKS(50));
+            continue;
+        }
+        if (!gameReady) {
+            initializeBoard();
+        }
+
+        if (gameReady && !hasNotifiedReady) {
+            // Homing belongs to the command task; it notifies the app once the gantry is parked.
+            enqueueCommand("ready");
+            hasNotifiedReady = true;
+        }
+
+        if (gameStarted) {
+            scanBoard();
+        } else {
+            vTaskDelay(pdMS_TO_TICKS(10));
+        }
+    }
+}
+
+void commandTask(void *) {
+    WriteMessage message;
+    while (true) {
+        // A short wait keeps GRBL streamed and its status fresh while commands are sparse.
+        if (xQueueReceive(writeQueue, &message, pdMS_TO_TICKS(5)) == pdTRUE) handleCommand(message.msg);
+        uint32_t now = millis();
+        cnc.poll(now);
+        if (afterServo && int32_t(now - servoSettledAt) >= 0) {
+            std::function<void()> then;
+            then.swap(afterServo);
+            then();
+        }
+    }
+}
 
 void setup() {
     Serial.begin(115200);
+    writeQueue = xQueueCreate(WRITE_QUEUE_LEN, sizeof(WriteMessage));
+    stateMutex = xSemaphoreCreateMutex();
     SPI.begin();
     strip.begin();
     strip.show();
     myServo.write(0);
 
-    pinMode(CLK, OUTPUT);
-    pinMode(SER, OUTPUT);
+    readerChain.begin();
     pinMode(CLR, OUTPUT);
     digitalWrite(CLR, HIGH);
     clearRegisters();
@@ -574,29 +870,14 @@ void setup() {
     // attach servo (will use LEDC channel under the hood)
     myServo.setPeriodHertz(50); // 50 Hz for most servos
     myServo.attach(SERVO_PIN, 500, 2400);
-    grbl.println("$X");
-    grbl.println("$H");
+    cnc.send("$X");
+    cnc.send("$H");
+
+    xTaskCreatePinnedToCore(scanTask, "scan", TASK_STACK, nullptr, 1, nullptr, SCAN_CORE);
+    xTaskCreatePinnedToCore(commandTask, "command", TASK_STACK, nullptr, 1, nullptr, COMMAND_CORE);
 }
 
 void loop() {
-    if (!deviceConnected) return;
-    if (!gameReady) {
-        initializeBoard();
-    }
-
-    if (gameReady && !hasNotifiedReady) {
-        myServo.write(0);
-        delay(50);
-        grbl.println("$X");
-        grbl.println("$H");
-        delay(2000);
-        statusChar->setValue("ready_to_start");
-        statusChar->notify();
-        hasNotifiedReady = true;
-        Serial.println("Notified app: ready_to_start");
-    }
-
-    if (gameStarted) {
-        scanBoard();
-    }
+    // All work happens in scanTask and commandTask.
+    vTaskDelete(NULL);
 }
@@ -0,0 +1,134 @@
+#ifndef GRBL_SIM_H
+#define GRBL_SIM_H
+
+#include "GrblController.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <string>
+
+// Stands in for GRBL on the serial line: a 128-byte receive buffer feeding a 15-block planner, "ok" once a
+// line is planned, real-time '?' answered at once, and blocks executed as advance() moves the clock. Each
+// block runs a trapezoid from rest to rest at the modal feed rate and the $120 acceleration; $ settings are
+// refused with error:8 while moving, as GRBL does. Records what the tests want to check: buffer overflows
+// and how often the machine had to start from rest.
+class GrblSim : public GrblLink {
+public:
+    static constexpr size_t PLANNER_BLOCKS = 15;
+    static constexpr float RAPID_MM_PER_MIN = 6000;
+
+    int available() override { return static_cast<int>(output.size()); }
+
+    int read() override {
+        if (output.empty()) return -1;
+        char c = output.front();
+        output.pop_front();
+        return static_cast<unsigned char>(c);
+    }
+
+    void write(const char *data, size_t length) override {
+        for (size_t i = 0; i < length; ++i) {
+            if (data[i] == '?') {
+                reply(status());
+            } else {
+                rx += data[i];
+            }
+        }
+        if (rx.size() > GrblController::RX_BUFFER_SIZE) overflowed = true;
+        plan();
+    }
+
+    // Runs the machine for ms milliseconds.
+    void advance(float ms) {
+        while (ms > 0 && !planner.empty()) {
+            Block &block = planner.front();
+            if (!running) {
+                running = true;
+                motionStarts++;
+            }
+            float step = std::min(ms, block.remainingMs);
+            if (step > 0) {
+                x += (block.x - x) * step / block.remainingMs;
+                y += (block.y - y) * step / block.remainingMs;
+                block.remainingMs -= step;
+                ms -= step;
+            }
+            if (block.remainingMs <= 0) {
+                x = block.x;
+                y = block.y;
+                planner.pop_front();
+                plan();
+            }
+        }
+        if (planner.empty()) running = false;
+    }
+
+    float x = 0, y = 0;
+    float acceleration = 500; // mm/s²
+    bool overflowed = false;
+    int motionStarts = 0; // times the machine went from rest to moving
+    size_t maxPlanned = 0;
+
+private:
+    struct Block {
+        float x, y;
+        float remainingMs;
+    };
+
+    void reply(const std::string &line) {
+        for (char c : line) output.push_back(c);
+        output.push_back('\r');
+        output.push_back('\n');
+    }
+
+    std::string status() const {
+        char line[64];
+        snprintf(line, sizeof(line), "<%s|MPos:%.3f,%.3f,0.000|FS:0,0>", planner.empty() ? "Idle" : "Run", x, y);
+        return line;
+    }
+
+    // Moves complete lines from the receive buffer into the planner while it has room.
+    void plan() {
+        size_t newline;
+        while (planner.size() < PLANNER_BLOCKS && (newline = rx.find('\n')) != std::string::npos) {
+            std::string line = rx.substr(0, newline);
+            rx.erase(0, newline + 1);
+            if (line[0] == '$') {
+                if (!planner.empty()) {
+                    reply("error:8");
+                    continue;
+                }
+                if (line.compare(0, 5, "$120=") == 0) acceleration = std::strtof(line.c_str() + 5, nullptr);
+            } else if (line[0] == 'G') {
+                float tx = word(line, 'X', planned().x), ty = word(line, 'Y', planned().y);
+                if (line[1] == '1') feedRate = word(line, 'F', feedRate);
+                float speed = (line[1] == '1' ? feedRate : RAPID_MM_PER_MIN) / 60; // mm/s
+                float distance = std::hypot(tx - planned().x, ty - planned().y);
+                float seconds = distance >= speed * speed / acceleration ? distance / speed + speed / acceleration
+                                                                         : 2 * std::sqrt(distance / acceleration);
+                if (line[1] == '4') seconds = word(line, 'P', 0);
+                planner.push_back({tx, ty, seconds * 1000});
+                maxPlanned = std::max(maxPlanned, planner.size());
+            }
+            reply("ok");
+        }
+    }
+
+    static float word(const std::string &line, char letter, float fallback) {
+        size_t pos = line.find(letter);
+        return pos == std::string::npos ? fallback : std::strtof(line.c_str() + pos + 1, nullptr);
+    }
+
+    // Where the machine will be once everything planned has run.
+    Block planned() const { return planner.empty() ? Block{x, y, 0} : planner.back(); }
+
+    std::string rx;
+    std::deque<char> output;
+    std::deque<Block> planner;
+    float feedRate = RAPID_MM_PER_MIN; // modal, like G-code's F
+    bool running = false;
+};
+
+#endif
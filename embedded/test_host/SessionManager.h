@@ -0,0 +1,154 @@
+#ifndef SESSION_MANAGER_H
+#define SESSION_MANAGER_H
+
+#include "BitBoard.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Recycles fixed-size blocks through a free list instead of returning them to the heap, carving new
+// blocks out of 64-block chunks. One pool exists per rebound type, so allocate_shared puts each Game and
+// its control block in a single pooled allocation.
+template <typename T>
+class PoolAllocator {
+public:
+    using value_type = T;
+
+    PoolAllocator() = default;
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U> &) {}
+
+    T *allocate(std::size_t n) {
+        if (n != 1) return static_cast<T *>(::operator new(n * sizeof(T)));
+        std::lock_guard<std::mutex> lock(pool().mutex);
+        if (!pool().free) pool().grow();
+        Block *block = pool().free;
+        pool().free = block->next;
+        return reinterpret_cast<T *>(block);
+    }
+
+    void deallocate(T *p, std::size_t n) {
+        if (n != 1) return ::operator delete(p);
+        std::lock_guard<std::mutex> lock(pool().mutex);
+        Block *block = reinterpret_cast<Block *>(p);
+        block->next = pool().free;
+        pool().free = block;
+    }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U> &) const { return true; }
+    template <typename U>
+    bool operator!=(const PoolAllocator<U> &) const { return false; }
+
+private:
+    union Block {
+        Block *next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    struct Pool {
+        static const int CHUNK = 64;
+        std::mutex mutex;
+        Block *free = nullptr;
+        std::vector<std::unique_ptr<Block[]>> chunks;
+
+        void grow() {
+            chunks.emplace_back(new Block[CHUNK]);
+            for (int i = 0; i < CHUNK; ++i) {
+                chunks.back()[i].next = free;
+                free = &chunks.back()[i];
+            }
+        }
+    };
+
+    static Pool &pool() {
+        static Pool instance;
+        return instance;
+    }
+};
+
+// A move as pushed to /events subscribers, together with the hash of the position it led to.
+struct MoveEvent {
+    Move move;
+    uint64_t hash;
+};
+
+// One independent game. Handlers hold the mutex for the whole request, so moves on one game are
+// serialised while other games proceed in parallel. The position is a BitBoard held inline and nothing
+// else allocates until moves are played, so creating a game is the one pooled block; the handlers work on
+// the engine directly rather than keeping a Board, with its piece handles and maps, per game.
+struct Game {
+    // Older moves are dropped; a subscriber that far behind resumes at the oldest one kept and can refetch
+    // /board_state.
+    static constexpr size_t EVENT_HISTORY = 256;
+
+    Game() { position.setInitial(); }
+
+    std::mutex mutex;
+    BitBoard position;
+    std::string legalMovesJson; // cached /legal_moves response for legalMovesHash
+    uint64_t legalMovesHash = 0;
+    std::vector<MoveEvent> events; // ring of the latest moves; event id n lives at n % EVENT_HISTORY
+    size_t eventCount = 0;         // moves played, and the id of the next event
+    std::condition_variable moved; // notified under mutex whenever an event is recorded
+    int subscribers = 0;           // open /events streams
+
+    void record(const MoveEvent &event) {
+        if (events.size() < EVENT_HISTORY) {
+            events.push_back(event);
+        } else {
+            events[eventCount % EVENT_HISTORY] = event;
+        }
+        ++eventCount;
+        moved.notify_all();
+    }
+    size_t firstEvent() const { return eventCount - events.size(); }
+    size_t nextEvent() const { return eventCount; }
+    const MoveEvent &event(size_t id) const { return events[id % EVENT_HISTORY]; }
+};
+
+class SessionManager {
+public:
+    std::string create() {
+        char id[17];
+        std::snprintf(id, sizeof(id), "%016llx", static_cast<unsigned long long>(nextId++ * 0x9E3779B97F4A7C15ULL));
+        create(id);
+        return id;
+    }
+
+    void create(const std::string &id) {
+        auto game = std::allocate_shared<Game>(PoolAllocator<Game>());
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        games[id] = std::move(game);
+    }
+
+    // Returns nullptr for an unknown id. The shared_ptr keeps the game alive if it is erased mid-request.
+    std::shared_ptr<Game> find(const std::string &id) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = games.find(id);
+        return it == games.end() ? nullptr : it->second;
+    }
+
+    bool erase(const std::string &id) {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        return games.erase(id) > 0;
+    }
+
+    size_t size() const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        return games.size();
+    }
+
+private:
+    mutable std::shared_mutex mutex;
+    std::unordered_map<std::string, std::shared_ptr<Game>> games;
+    std::atomic<uint64_t> nextId{1};
+};
+
+#endif
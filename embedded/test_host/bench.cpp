@@ -0,0 +1,160 @@
+#include "Board.h"
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <new>
+
+// Microbenchmarks for the rules engine paths the board hits on every lift and every move.
+// Run with --benchmark_format=json (or --benchmark_out=<file>) to keep results for comparison.
+
+static std::atomic<size_t> allocations{0};
+
+void *operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+struct Position {
+    const char *name;
+    const char *fen;
+};
+
+const Position CORPUS[] = {
+    {"opening", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"},
+    {"middlegame", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10"},
+    {"endgame", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1"},
+    {"castling", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"},
+    {"en_passant", "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3"},
+    {"promotion", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1"},
+};
+
+Board boardFromFEN(const char *fen) {
+    auto board = Board::fromFEN(fen);
+    if (!board) std::abort();
+    return board.value();
+}
+
+std::vector<std::shared_ptr<Piece>> sideToMovePieces(const Board &board) {
+    std::vector<std::shared_ptr<Piece>> pieces;
+    for (const auto &[piece, pos] : board.pieceToCoordinate)
+        if (piece->color == board.engine.sideToMove) pieces.push_back(piece);
+    return pieces;
+}
+
+void reportAllocations(benchmark::State &state, size_t before) {
+    state.counters["allocs/op"] =
+        benchmark::Counter(double(allocations.load() - before), benchmark::Counter::kAvgIterations);
+}
+
+// What the server and LEDs use today: one unordered_set of squares per lifted piece.
+void validMovesSets(benchmark::State &state, const char *fen) {
+    Board board = boardFromFEN(fen);
+    auto pieces = sideToMovePieces(board);
+    size_t before = allocations.load();
+    for (auto _ : state)
+        for (const auto &piece : pieces) benchmark::DoNotOptimize(board.getValidMoves(piece));
+    reportAllocations(state, before);
+}
+
+void validMovesList(benchmark::State &state, const char *fen) {
+    Board board = boardFromFEN(fen);
+    size_t before = allocations.load();
+    for (auto _ : state) {
+        MoveList moves;
+        board.getValidMoves(board.engine.sideToMove, moves);
+        benchmark::DoNotOptimize(moves);
+    }
+    reportAllocations(state, before);
+}
+
+void pseudoMoveSets(benchmark::State &state, const char *fen) {
+    Board board = boardFromFEN(fen);
+    auto pieces = sideToMovePieces(board);
+    size_t before = allocations.load();
+    for (auto _ : state)
+        for (const auto &piece : pieces) benchmark::DoNotOptimize(board.pseudoMoves(piece));
+    reportAllocations(state, before);
+}
+
+void isCheck(benchmark::State &state, const char *fen) {
+    Board board = boardFromFEN(fen);
+    size_t before = allocations.load();
+    for (auto _ : state) benchmark::DoNotOptimize(board.isCheck(board.engine.sideToMove));
+    reportAllocations(state, before);
+}
+
+// Plays and takes back every legal move, so one op is a full sweep of the position.
+void movePiece(benchmark::State &state, const char *fen) {
+    Board board = boardFromFEN(fen);
+    MoveList moves;
+    board.getValidMoves(board.engine.sideToMove, moves);
+    size_t before = allocations.load();
+    for (auto _ : state) {
+        for (Move move : moves) {
+            board.movePiece(move);
+            board.unmakeMove();
+        }
+    }
+    reportAllocations(state, before);
+    state.counters["moves/op"] = moves.size();
+}
+
+void fromFEN(benchmark::State &state, const char *fen) {
+    size_t before = allocations.load();
+    for (auto _ : state) benchmark::DoNotOptimize(Board::fromFEN(fen));
+    reportAllocations(state, before);
+}
+
+uint64_t perft(BitBoard &board, int depth) {
+    MoveList moves;
+    board.legalMoves(board.sideToMove, moves);
+    if (depth == 1) return moves.size();
+    uint64_t nodes = 0;
+    for (Move move : moves) {
+        Undo undo = board.makeMove(move);
+        nodes += perft(board, depth - 1);
+        board.unmakeMove(undo);
+    }
+    return nodes;
+}
+
+void enginePerft(benchmark::State &state, const char *fen) {
+    BitBoard board;
+    board.setFEN(fen);
+    uint64_t nodes = 0;
+    size_t before = allocations.load();
+    for (auto _ : state) nodes += perft(board, 3);
+    reportAllocations(state, before);
+    state.counters["nodes/s"] = benchmark::Counter(double(nodes), benchmark::Counter::kIsRate);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const std::pair<const char *, void (*)(benchmark::State &, const char *)> benchmarks[] = {
+        {"getValidMoves/set", validMovesSets}, {"getValidMoves/list", validMovesList},
+        {"pseudoMoves/set", pseudoMoveSets},   {"isCheck", isCheck},
+        {"movePiece", movePiece},              {"perft3", enginePerft},
+        {"fromFEN", fromFEN},
+    };
+    for (const auto &[name, function] : benchmarks)
+        for (const Position &position : CORPUS)
+            benchmark::RegisterBenchmark((std::string(name) + "/" + position.name).c_str(), function, position.fen);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
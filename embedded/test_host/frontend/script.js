@@ -1,6 +1,7 @@
 const boardEl = document.getElementById("board");
 let selected = null;
 let validMoves = [];
+let legalMoves = {};
 const pieceUnicode = {
   P: "♙",
   N: "♘",
@@ -35,27 +36,36 @@ function handleClick(e) {
     ).then(() => {
       selected = null;
       validMoves = [];
-      renderBoard();
+      // Moves made elsewhere (another tab, a spectator's opponent) arrive here as they happen.
+new EventSource("http://localhost:8080/events").addEventListener("move", () => {
+  selected = null;
+  validMoves = [];
+  renderBoard();
+});
+
+renderBoard();
     });
   } else {
-    fetch(`http://localhost:8080/valid_moves?x=${x}&y=${y}`)
-      .then((res) => res.json())
-      .then((moves) => {
-        selected = { x, y };
-        validMoves = moves;
-        renderBoard();
-      });
+    selected = { x, y };
+    validMoves = legalMoves[squareName(x, y)] || [];
+    drawBoard();
   }
 }
+
+function squareName(x, y) {
+  return String.fromCharCode(96 + x) + y;
+}
 let boardMatrix = [];
 
 function renderBoard() {
-  fetch("http://localhost:8080/board_state")
-    .then((res) => res.json())
-    .then((matrix) => {
-      boardMatrix = matrix;
-      drawBoard();
-    });
+  Promise.all([
+    fetch("http://localhost:8080/board_state").then((res) => res.json()),
+    fetch("http://localhost:8080/legal_moves").then((res) => res.json()),
+  ]).then(([matrix, moves]) => {
+    boardMatrix = matrix;
+    legalMoves = moves;
+    drawBoard();
+  });
 }
 
 function drawBoard() {
@@ -77,4 +87,11 @@ function drawBoard() {
   }
 }
 
+// Moves made elsewhere (another tab, a spectator's opponent) arrive here as they happen.
+new EventSource("http://localhost:8080/events").addEventListener("move", () => {
+  selected = null;
+  validMoves = [];
+  renderBoard();
+});
+
 renderBoard();
@@ -0,0 +1,82 @@
+#include "BitBoard.h"
+#include "CncMovePlanner.h"
+#include "GrblSim.h"
+#include "MotionProfile.h"
+#include <cstdio>
+#include <string>
+
+// Usage: motion [setting ...], e.g. motion king.congested=1200 acceleration=300 travel=5000
+//
+// Plays a short game with captures, castling on both wings, en passant and a promotion on the simulated
+// gantry, using the default motion profiles with the given settings applied on top, and prints how long
+// each move took. Compare the totals to tune the profiles before trying them on the board.
+
+namespace {
+
+const char *GAME[] = {"e2e4", "d7d5", "e4e5", "f7f5", "e5f6", "b8c6", "f6g7", "c8e6", "g7h8q", "d8d6",
+                      "g1f3", "e8c8", "f1e2", "d5d4", "e1g1", "c6e5", "f3e5", "d6e5", "h8g8", "e5e2"};
+
+const uint32_t SERVO_MS = 250 + 150; // engage and release
+
+struct Gantry {
+    GrblSim sim;
+    GrblController cnc{sim};
+    uint32_t now = 0;
+
+    void runUntilIdle() {
+        bool idle = false;
+        cnc.onIdle([&] { idle = true; });
+        while (!idle) {
+            cnc.poll(now);
+            sim.advance(1);
+            ++now;
+        }
+    }
+
+    void play(const CncLeg &leg, const MotionProfiles &profiles) {
+        cnc.setAcceleration(profiles.acceleration);
+        cnc.moveTo(leg.path.front().x, leg.path.front().y, profiles.travelFeedRate);
+        runUntilIdle();
+        cnc.send(profiles.program(leg));
+        runUntilIdle();
+        now += SERVO_MS;
+    }
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+    MotionProfiles profiles;
+    for (int i = 1; i < argc; ++i) {
+        if (!profiles.set(argv[i])) {
+            fprintf(stderr, "Bad setting '%s': expected e.g. knight.open=5000, acceleration=300 or travel=9000\n", argv[i]);
+            return 1;
+        }
+    }
+
+    Gantry gantry;
+    CncMovePlanner planner;
+    planner.swapPromotions = true;
+    BitBoard board;
+    board.setInitial();
+    for (const char *uci : GAME) {
+        std::string text = uci;
+        int from = (text[1] - '1') * 8 + text[0] - 'a', to = (text[3] - '1') * 8 + text[2] - 'a';
+        PieceType promotion = text.size() > 4 ? PieceType(KNIGHT + std::string("nbrq").find(text[4])) : QUEEN;
+        Move move = board.encode(from, to, promotion);
+        MoveList legal;
+        board.legalMoves(board.sideToMove, legal);
+        if (!legal.contains(move)) {
+            fprintf(stderr, "%s is not legal here\n", uci);
+            return 1;
+        }
+
+        uint32_t start = gantry.now;
+        auto legs = planner.plan(board, move, {gantry.sim.x, gantry.sim.y});
+        for (const CncLeg &leg : legs) gantry.play(leg, profiles);
+        printf("%-6s %zu leg%s %6.2f s\n", uci, legs.size(), legs.size() == 1 ? " " : "s", (gantry.now - start) / 1000.0);
+        board.makeMove(move);
+    }
+    printf("Total %.2f s, %u GRBL errors\n", gantry.now / 1000.0, gantry.cnc.errors());
+    return gantry.cnc.errors() ? 1 : 0;
+}
@@ -0,0 +1,142 @@
+#include "BitBoard.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Usage: perft <depth> [startpos | kiwipete | "<fen>"] [-t threads] [-H hash MB]
+//
+// Prints one "<move>: <nodes>" line per root move followed by "Nodes searched: <total>", the same
+// divide format as stockfish's "go perft", so the output can be diffed against it directly.
+
+namespace {
+
+const char *START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+const char *KIWIPETE_FEN = "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1";
+
+// Shared by every worker without locks. Each entry stores its data next to key ^ data, so an entry
+// torn by two threads writing at once no longer matches its key and is simply treated as a miss.
+class PerftTable {
+public:
+    explicit PerftTable(size_t megabytes) {
+        size_t count = 1;
+        while (count * 2 * sizeof(Entry) <= megabytes << 20) count *= 2;
+        if (megabytes > 0) {
+            entries.reset(new Entry[count]);
+            mask = count - 1;
+        }
+    }
+
+    bool probe(uint64_t hash, int depth, uint64_t &nodes) const {
+        if (!entries) return false;
+        const Entry &entry = entries[index(hash, depth)];
+        uint64_t data = entry.data.load(std::memory_order_relaxed);
+        if ((entry.check.load(std::memory_order_relaxed) ^ data) != hash || (data & 0xFF) != uint64_t(depth))
+            return false;
+        nodes = data >> 8;
+        return true;
+    }
+
+    void store(uint64_t hash, int depth, uint64_t nodes) {
+        if (!entries) return;
+        Entry &entry = entries[index(hash, depth)];
+        uint64_t data = nodes << 8 | depth;
+        entry.check.store(hash ^ data, std::memory_order_relaxed);
+        entry.data.store(data, std::memory_order_relaxed);
+    }
+
+private:
+    struct Entry {
+        std::atomic<uint64_t> check{0};
+        std::atomic<uint64_t> data{0};
+    };
+
+    size_t index(uint64_t hash, int depth) const { return (hash ^ depth * 0x9E3779B97F4A7C15ULL) & mask; }
+
+    std::unique_ptr<Entry[]> entries;
+    size_t mask = 0;
+};
+
+uint64_t perft(BitBoard &board, int depth, PerftTable &table) {
+    if (depth == 0) return 1;
+    uint64_t nodes = 0;
+    if (depth > 1 && table.probe(board.hash(), depth, nodes)) return nodes;
+
+    MoveList moves;
+    board.legalMoves(board.sideToMove, moves);
+    if (depth == 1) return moves.size();
+    for (Move move : moves) {
+        Undo undo = board.makeMove(move);
+        nodes += perft(board, depth - 1, table);
+        board.unmakeMove(undo);
+    }
+    if (depth > 1) table.store(board.hash(), depth, nodes);
+    return nodes;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <depth> [startpos | kiwipete | \"<fen>\"] [-t threads] [-H hash MB]\n", argv[0]);
+        return 1;
+    }
+    int depth = std::atoi(argv[1]);
+    std::string fen = START_FEN;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t hashMegabytes = 256;
+    for (int i = 2; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "-t") && i + 1 < argc)
+            threads = std::max(1, std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "-H") && i + 1 < argc)
+            hashMegabytes = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "kiwipete"))
+            fen = KIWIPETE_FEN;
+        else if (std::strcmp(argv[i], "startpos"))
+            fen = argv[i];
+    }
+
+    BitBoard root;
+    if (depth < 1 || !root.setFEN(fen)) {
+        std::fprintf(stderr, "invalid depth or FEN: %d \"%s\"\n", depth, fen.c_str());
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    PerftTable table(hashMegabytes);
+    MoveList moves;
+    root.legalMoves(root.sideToMove, moves);
+    std::vector<uint64_t> counts(moves.size());
+    std::atomic<int> next{0};
+
+    // Workers pull root moves one at a time, so a few expensive subtrees don't leave the rest idle.
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < std::min<unsigned>(threads, moves.size()); ++t) {
+        pool.emplace_back([&] {
+            BitBoard board = root;
+            for (int i = next++; i < moves.size(); i = next++) {
+                Undo undo = board.makeMove(moves[i]);
+                counts[i] = perft(board, depth - 1, table);
+                board.unmakeMove(undo);
+            }
+        });
+    }
+    for (auto &worker : pool) worker.join();
+
+    uint64_t total = 0;
+    for (int i = 0; i < moves.size(); ++i) {
+        std::printf("%s: %llu\n", moveToUci(moves[i]).c_str(), static_cast<unsigned long long>(counts[i]));
+        total += counts[i];
+    }
+    std::printf("\nNodes searched: %llu\n", static_cast<unsigned long long>(total));
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::fprintf(stderr, "%.2fs, %u threads, %zu MB hash\n", seconds, threads, hashMegabytes);
+    return 0;
+}
@@ -1,53 +1,263 @@
-#include "Board.h"
+#include "BitBoard.h"
+#include "Search.h"
+#include "SessionManager.h"
 #include "httplib.h"
 #include "json.hpp"
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <thread>
 using json = nlohmann::json;
 
+// Requests without a ?game= parameter play on this game, so the single-board frontend keeps working.
+const char DEFAULT_GAME[] = "default";
+
+// Looks up the game named by the request, answering 404 itself when there is none.
+static std::shared_ptr<Game> requestGame(SessionManager &sessions, const httplib::Request &req, httplib::Response &res) {
+    std::string id = req.has_param("game") ? req.get_param_value("game") : DEFAULT_GAME;
+    auto game = sessions.find(id);
+    if (!game) {
+        res.status = 404;
+        res.set_content("{\"error\": \"Unknown game\"}", "application/json");
+    }
+    return game;
+}
+
+// A non-negative decimal header or parameter; false for anything else, which stoul would throw on or wrap.
+static bool parseCount(const std::string &text, unsigned long &value) {
+    if (text.empty() || text.size() > 9) return false;
+    for (char c : text) {
+        if (!std::isdigit(static_cast<unsigned char>(c))) return false;
+    }
+    value = std::stoul(text);
+    return true;
+}
+
+// The square named by a pair of 1-8 parameters (a1 is x=1, y=1), or -1 if either is missing or off the board.
+static int squareParam(const httplib::Request &req, const char *xName, const char *yName) {
+    unsigned long x, y;
+    if (!parseCount(req.get_param_value(xName), x) || !parseCount(req.get_param_value(yName), y)) return -1;
+    if (x < 1 || x > 8 || y < 1 || y > 8) return -1;
+    return int(y - 1) * 8 + int(x - 1);
+}
+
+static void badRequest(httplib::Response &res, const char *message) {
+    res.status = 400;
+    res.set_content(json{{"error", message}}.dump(), "application/json");
+}
+
+enum class BoardFormat { Json, Fen, Packed };
+
+// ?format=fen|packed wins; otherwise text/plain or application/octet-stream in Accept pick the compact forms.
+static BoardFormat boardFormat(const httplib::Request &req) {
+    std::string format = req.get_param_value("format");
+    std::string accept = req.get_header_value("Accept");
+    if (format == "fen" || (format.empty() && accept.find("text/plain") != std::string::npos)) return BoardFormat::Fen;
+    if (format == "packed" || (format.empty() && accept.find("application/octet-stream") != std::string::npos))
+        return BoardFormat::Packed;
+    return BoardFormat::Json;
+}
+
+// 34 bytes: squares a1..h8 two per byte (low nibble first, 0 = empty, else piece code + 1), then
+// castling rights in bits 0-3 with bit 4 set when white is to move, then the en passant square (64 = none).
+static void writePacked(const BitBoard &engine, std::string &out) {
+    out.assign(34, '\0');
+    for (int square = 0; square < 64; ++square) {
+        uint8_t piece = engine.at(square);
+        uint8_t nibble = piece == EMPTY_SQUARE ? 0 : piece + 1;
+        out[square / 2] |= static_cast<char>(square % 2 ? nibble << 4 : nibble);
+    }
+    out[32] = static_cast<char>(engine.castling | (engine.sideToMove == White ? 0x10 : 0));
+    out[33] = static_cast<char>(engine.enPassant);
+}
+
+// Each /events subscriber holds a worker for as long as it stays connected, so streams are capped well
+// below the pool size and the other endpoints always have workers left.
+const int WORKERS = 64;
+const int MAX_STREAMS = 48;
+const int MAX_STREAMS_PER_GAME = 8;
+
 int main() {
     httplib::Server svr;
-    Board board;
-    std::unordered_map<std::string, char> pieceMap = {
-        {"Pawn", 'P'},
-        {"Knight", 'N'},
-        {"Bishop", 'B'},
-        {"Castle", 'R'},
-        {"Queen", 'Q'},
-        {"King", 'K'}};
+    SessionManager sessions;
+    std::atomic<int> streams{0};
+    svr.new_task_queue = [] { return new httplib::ThreadPool(WORKERS); };
+    sessions.create(DEFAULT_GAME);
+    const char pieceChars[] = {'P', 'N', 'B', 'R', 'Q', 'K'};
 
     // Allow CORS for all requests
     svr.set_default_headers({{"Access-Control-Allow-Origin", "*"},
-                             {"Access-Control-Allow-Methods", "GET, POST, OPTIONS"},
-                             {"Access-Control-Allow-Headers", "Content-Type"}});
+                             {"Access-Control-Allow-Methods", "GET, POST, DELETE, OPTIONS"},
+                             {"Access-Control-Allow-Headers", "Content-Type, If-None-Match"},
+                             {"Access-Control-Expose-Headers", "ETag"}});
+
+    svr.Post("/games", [&](const httplib::Request &, httplib::Response &res) {
+        res.set_content(json{{"game", sessions.create()}}.dump(), "application/json");
+    });
+
+    svr.Delete(R"(/games/(\w+))", [&](const httplib::Request &req, httplib::Response &res) {
+        if (!sessions.erase(req.matches[1])) res.status = 404;
+    });
 
     svr.Get("/valid_moves", [&](const httplib::Request &req, httplib::Response &res) {
-        if (!req.has_param("x") || !req.has_param("y")) {
-            res.status = 400;
-            res.set_content("{\"error\": \"Missing x or y\"}", "application/json");
-            return;
-        }
-        int x = std::stoi(req.get_param_value("x"));
-        int y = std::stoi(req.get_param_value("y"));
-        auto piece = board.getPiece(XYPos(x, y));
+        int square = squareParam(req, "x", "y");
+        if (square < 0) return badRequest(res, "Missing x or y");
+        auto game = requestGame(sessions, req, res);
+        if (!game) return;
+        std::lock_guard<std::mutex> lock(game->mutex);
         json response = json::array();
-        if (piece.has_value()) {
-            auto moves = board.getValidMoves(piece.value());
-            for (const auto &move : moves) {
-                response.push_back({{"x", static_cast<int>(move.x)}, {"y", move.y}});
+        for (Bitboard targets = game->position.legalTargets(square); targets;) {
+            int target = popLsb(targets);
+            response.push_back({{"x", fileOf(target) + 1}, {"y", rankOf(target) + 1}});
+        }
+        res.set_content(response.dump(), "application/json");
+    });
+
+    // Every legal move for the side to move, grouped by origin square: {"e2": [{"x": 5, "y": 3}, ...], ...}.
+    // Rebuilt only when the position hash changes, i.e. after the next /move_piece.
+    svr.Get("/legal_moves", [&](const httplib::Request &req, httplib::Response &res) {
+        auto game = requestGame(sessions, req, res);
+        if (!game) return;
+        std::lock_guard<std::mutex> lock(game->mutex);
+        BitBoard &position = game->position;
+        std::string &legalMovesJson = game->legalMovesJson;
+        if (legalMovesJson.empty() || game->legalMovesHash != position.hash()) {
+            MoveList moves;
+            position.legalMoves(position.sideToMove, moves);
+            json response = json::object();
+            for (Move move : moves) {
+                // The four promotions share a target square; the board only needs the square once.
+                if (isPromotion(move) && promotionType(move) != QUEEN) continue;
+                std::string origin = moveToUci(move).substr(0, 2);
+                if (!response.contains(origin)) response[origin] = json::array();
+                response[origin].push_back({{"x", moveTo(move) % 8 + 1}, {"y", moveTo(move) / 8 + 1}});
+            }
+            legalMovesJson = response.dump();
+            game->legalMovesHash = position.hash();
+        }
+        res.set_content(legalMovesJson, "application/json");
+    });
+
+    // Server-sent events: one "move" event per move played, resuming after Last-Event-ID when a client
+    // reconnects. Subscribers sleep on the game's condition variable until a move arrives.
+    svr.Get("/events", [&](const httplib::Request &req, httplib::Response &res) {
+        auto game = requestGame(sessions, req, res);
+        if (!game) return;
+        size_t next = 0;
+        if (req.has_header("Last-Event-ID")) {
+            unsigned long last;
+            if (!parseCount(req.get_header_value("Last-Event-ID"), last)) return badRequest(res, "Bad Last-Event-ID");
+            next = last + 1;
+        }
+        {
+            std::lock_guard<std::mutex> lock(game->mutex);
+            bool full = game->subscribers >= MAX_STREAMS_PER_GAME;
+            if (!full && streams.fetch_add(1) >= MAX_STREAMS) {
+                --streams;
+                full = true;
+            }
+            if (full) {
+                res.status = 503;
+                res.set_header("Retry-After", "30");
+                res.set_content("{\"error\": \"Too many subscribers\"}", "application/json");
+                return;
+            }
+            ++game->subscribers;
+        }
+        res.set_header("Cache-Control", "no-cache");
+        auto provider = [game, next](size_t, httplib::DataSink &sink) mutable {
+            std::unique_lock<std::mutex> lock(game->mutex);
+            // The timeout sends a comment now and then, which is how a closed connection gets noticed.
+            if (!game->moved.wait_for(lock, std::chrono::seconds(15), [&] { return game->nextEvent() > next; })) {
+                lock.unlock();
+                return sink.write(": keepalive\n\n", 13);
+            }
+            std::string out;
+            for (next = std::max(next, game->firstEvent()); next < game->nextEvent(); ++next) {
+                const MoveEvent &event = game->event(next);
+                char line[160];
+                int length = snprintf(line, sizeof(line),
+                                      "id: %zu\nevent: move\ndata: {\"from\": \"%.2s\", \"to\": \"%.2s\", \"flags\": %d, "
+                                      "\"hash\": \"%016llx\"}\n\n",
+                                      next, moveToUci(event.move).c_str(), moveToUci(event.move).c_str() + 2,
+                                      moveFlags(event.move), static_cast<unsigned long long>(event.hash));
+                out.append(line, length);
             }
+            lock.unlock();
+            return sink.write(out.data(), out.size());
+        };
+        res.set_chunked_content_provider("text/event-stream", provider, [game, &streams](bool) {
+            std::lock_guard<std::mutex> lock(game->mutex);
+            --game->subscribers;
+            --streams;
+        });
+    });
+
+    // Analysis backend: Lazy SMP over every core for ?ms= milliseconds (default 1000). One search runs at a
+    // time; the game is only locked while its position is copied.
+    Search search;
+    std::mutex searchMutex;
+    svr.Get("/best_move", [&](const httplib::Request &req, httplib::Response &res) {
+        auto game = requestGame(sessions, req, res);
+        if (!game) return;
+        BitBoard position;
+        {
+            std::lock_guard<std::mutex> lock(game->mutex);
+            position = game->position;
         }
+        SearchLimits limits;
+        unsigned long ms = 1000;
+        if (req.has_param("ms") && !parseCount(req.get_param_value("ms"), ms)) return badRequest(res, "Bad ms");
+        limits.timeMs = ms;
+        limits.threads = std::max(1u, std::thread::hardware_concurrency());
+        std::lock_guard<std::mutex> lock(searchMutex);
+        SearchResult result = search.think(position, limits);
+        json response = {{"move", result.best == NO_MOVE ? "" : moveToUci(result.best)},
+                         {"score", result.score},
+                         {"depth", result.depth},
+                         {"nodes", result.nodes},
+                         {"nps", result.nodesPerSecond()}};
         res.set_content(response.dump(), "application/json");
     });
 
-    svr.Get("/board_state", [&](const httplib::Request &, httplib::Response &res) {
+    svr.Get("/board_state", [&](const httplib::Request &req, httplib::Response &res) {
+        auto game = requestGame(sessions, req, res);
+        if (!game) return;
+        std::lock_guard<std::mutex> lock(game->mutex);
+        const BitBoard &position = game->position;
+        // The position hash identifies the board, so pollers can skip unchanged states. FEN also carries the
+        // move counters, which the hash leaves out, so its tag includes them.
+        BoardFormat format = boardFormat(req);
+        char etag[40];
+        if (format == BoardFormat::Fen) {
+            snprintf(etag, sizeof(etag), "\"%016llx-%d-%u-%u\"", static_cast<unsigned long long>(position.hash()),
+                     int(format), unsigned(position.halfmoveClock), unsigned(position.fullmoveNumber));
+        } else {
+            snprintf(etag, sizeof(etag), "\"%016llx-%d\"", static_cast<unsigned long long>(position.hash()), int(format));
+        }
+        res.set_header("ETag", etag);
+        res.set_header("Vary", "Accept");
+        if (req.get_header_value("If-None-Match") == etag) {
+            res.status = 304;
+            return;
+        }
+        if (format == BoardFormat::Fen) {
+            res.set_content(position.toFEN(), "text/plain");
+            return;
+        }
+        if (format == BoardFormat::Packed) {
+            writePacked(position, res.body);
+            res.set_header("Content-Type", "application/octet-stream");
+            return;
+        }
         json boardArr = json::array();
         for (int y = 8; y >= 1; --y) {
             json row = json::array();
             for (int x = 1; x <= 8; ++x) {
-                auto pieceOpt = board.getPiece(XYPos(x, y));
-                if (pieceOpt.has_value()) {
-                    const auto &p = pieceOpt.value();
-                    char c = pieceMap[p->name];
-                    row.push_back(std::string(1, p->color == Color::White ? std::toupper(c) : std::tolower(c)));
+                uint8_t piece = position.at((y - 1) * 8 + x - 1);
+                if (piece != EMPTY_SQUARE) {
+                    char c = pieceChars[typeOf(piece)];
+                    row.push_back(std::string(1, colorOf(piece) == White ? std::toupper(c) : std::tolower(c)));
                 } else {
                     row.push_back("");
                 }
@@ -58,21 +268,26 @@ int main() {
     });
 
     svr.Get("/move_piece", [&](const httplib::Request &req, httplib::Response &res) {
-        json boardArr = json::array();
-        int fromX = std::stoi(req.get_param_value("fromX"));
-        int fromY = std::stoi(req.get_param_value("fromY"));
-        const int toX = std::stoi(req.get_param_value("toX"));
-        const int toY = std::stoi(req.get_param_value("toY"));
-        XYPos from(fromX, fromY);
-        XYPos to(toX, toY);
-        auto pieceOpt = board.getPiece(from);
-        if (!pieceOpt.has_value()) {
+        int from = squareParam(req, "fromX", "fromY"), to = squareParam(req, "toX", "toY");
+        if (from < 0 || to < 0) return badRequest(res, "Bad fromX, fromY, toX or toY");
+        auto game = requestGame(sessions, req, res);
+        if (!game) return;
+        std::lock_guard<std::mutex> lock(game->mutex);
+        BitBoard &position = game->position;
+        if (position.at(from) == EMPTY_SQUARE) {
             res.status = 404;
             res.set_content("{\"error\": \"No piece at source position\"}", "application/json");
             return;
         }
-        auto piece = pieceOpt.value();
-        board.movePiece(piece, to);
+        MoveList moves;
+        position.legalMoves(from, position.checkInfo(colorOf(position.at(from))), moves);
+        // The first move to a promotion square is the queen promotion; an illegal move is ignored.
+        for (Move move : moves) {
+            if (moveTo(move) != to) continue;
+            position.makeMove(move);
+            game->record({move, position.hash()});
+            break;
+        }
         res.set_content("{\"success\": true}", "application/json");
     });
 
@@ -1,27 +1,37 @@
 #include "../lib/Board/Board.h"
+#include "../lib/BitBoard/Magic.h"
+#include "../lib/CncMovePlanner/CncMovePlanner.h"
+#include "../lib/MotionProfile/MotionProfile.h"
+#include "../lib/PathPlanner/PathPlanner.h"
+#include "../lib/ReaderHealth/ReaderHealth.h"
+#include "../lib/ReaderSelect/ReaderSelect.h"
+#include "../lib/ScanScheduler/ScanScheduler.h"
+#include "../lib/Search/Search.h"
+#include "GrblSim.h"
+#include "SessionManager.h"
 #include <gtest/gtest.h>
 
-// Helper: clone a piece by name
+// Helper: clone a piece by type
 std::shared_ptr<Piece> clonePiece(const std::shared_ptr<Piece> &piece) {
-    if (piece->name == "Pawn") {
-        auto p = std::make_shared<Pawn>(*std::dynamic_pointer_cast<Pawn>(piece));
-        return p;
-    } else if (piece->name == "Knight") {
-        return std::make_shared<Knight>(*std::dynamic_pointer_cast<Knight>(piece));
-    } else if (piece->name == "Bishop") {
-        return std::make_shared<Bishop>(*std::dynamic_pointer_cast<Bishop>(piece));
-    } else if (piece->name == "Castle") {
-        return std::make_shared<Castle>(*std::dynamic_pointer_cast<Castle>(piece));
-    } else if (piece->name == "Queen") {
-        return std::make_shared<Queen>(*std::dynamic_pointer_cast<Queen>(piece));
-    } else if (piece->name == "King") {
-        return std::make_shared<King>(*std::dynamic_pointer_cast<King>(piece));
+    switch (piece->type) {
+    case PAWN:
+        return std::make_shared<Pawn>(*std::static_pointer_cast<Pawn>(piece));
+    case KNIGHT:
+        return std::make_shared<Knight>(*std::static_pointer_cast<Knight>(piece));
+    case BISHOP:
+        return std::make_shared<Bishop>(*std::static_pointer_cast<Bishop>(piece));
+    case ROOK:
+        return std::make_shared<Castle>(*std::static_pointer_cast<Castle>(piece));
+    case QUEEN:
+        return std::make_shared<Queen>(*std::static_pointer_cast<Queen>(piece));
+    case KING:
+        return std::make_shared<King>(*std::static_pointer_cast<King>(piece));
     }
     return nullptr;
 }
 
 Board deepCopyBoard(const Board &original) {
-    Board copy;
+    Board copy = original;
     copy.pieceToCoordinate.clear();
     copy.coordinateToPiece.clear();
 
@@ -30,83 +40,49 @@ Board deepCopyBoard(const Board &original) {
         copy.pieceToCoordinate[newPiece] = pos;
         copy.coordinateToPiece[pos] = newPiece;
 
-        if (newPiece->name == "King") {
+        if (newPiece->type == KING) {
             if (newPiece->color == Color::White)
-                copy.whiteKing = std::dynamic_pointer_cast<King>(newPiece);
+                copy.whiteKing = std::static_pointer_cast<King>(newPiece);
             else
-                copy.blackKing = std::dynamic_pointer_cast<King>(newPiece);
+                copy.blackKing = std::static_pointer_cast<King>(newPiece);
         }
     }
 
     return copy;
 }
 
-int moveGenerationTest(Board board, int depth, const Color &color) {
+int moveGenerationTest(Board &board, int depth, const Color &color) {
     if (depth == 0) return 1;
 
     Color nextColor = (color == Color::White) ? Color::Black : Color::White;
-    int total = 0;
-
-    for (const auto &[piece, pos] : board.pieceToCoordinate) {
-        if (piece->color != color) continue;
+    MoveList moves;
+    board.getValidMoves(color, moves);
+    if (depth == 1) return moves.size();
 
-        auto moves = board.getValidMoves(piece);
-        for (const auto &move : moves) {
-            // Create a new board for this move
-            Board newBoard = deepCopyBoard(board);
-            
-            // Find the corresponding piece in the new board
-            std::shared_ptr<Piece> newPiece = nullptr;
-            for (const auto &[p, position] : newBoard.pieceToCoordinate) {
-                if (position == pos && p->name == piece->name && p->color == piece->color) {
-                    newPiece = p;
-                    break;
-                }
-            }
-            
-            if (newPiece) {
-                // Use the piece from the copied board
-                XYPos newMove(move); // Create a copy of the move position
-                newBoard.movePiece(newPiece, newMove);
-                total += moveGenerationTest(newBoard, depth - 1, nextColor);
-            }
-        }
+    int total = 0;
+    for (Move move : moves) {
+        board.makeMove(move);
+        total += moveGenerationTest(board, depth - 1, nextColor);
+        board.unmakeMove();
     }
-
     return total;
 }
 
 void perftBreakdown(Board &board, int depth, Color color) {
     int total = 0;
     Color nextColor = (color == Color::White) ? Color::Black : Color::White;
-    
-    for (const auto &[piece, pos] : board.pieceToCoordinate) {
-        if (piece->color != color) continue;
-
-        auto moves = board.getValidMoves(piece);
-        for (const auto &move : moves) {
-            // Create a new board for this move
-            Board newBoard = deepCopyBoard(board);
-            
-            // Find the corresponding piece in the new board
-            std::shared_ptr<Piece> newPiece = nullptr;
-            for (const auto &[p, position] : newBoard.pieceToCoordinate) {
-                if (position == pos && p->name == piece->name && p->color == piece->color) {
-                    newPiece = p;
-                    break;
-                }
-            }
-            
-            if (newPiece) {
-                // Use the piece from the copied board
-                XYPos newMove(move); // Create a copy of the move position
-                newBoard.movePiece(newPiece, newMove);
-                
-                int subTotal = moveGenerationTest(newBoard, depth - 1, nextColor);
-                std::cout << *piece << " " << pos << " → " << move << ": " << subTotal << std::endl;
-                total += subTotal;
-            }
-        }
+    MoveList moves;
+    board.getValidMoves(color, moves);
+
+    for (Move move : moves) {
+        XYPos from(moveFrom(move) % 8 + 1, moveFrom(move) / 8 + 1);
+        XYPos to(moveTo(move) % 8 + 1, moveTo(move) / 8 + 1);
+        auto piece = board.getPiece(from).value();
+        board.makeMove(move);
+        int subTotal = moveGenerationTest(board, depth - 1, nextColor);
+        board.unmakeMove();
+        std::cout << *piece << " " << from << " → " << to << ": " << subTotal << std::endl;
+        total += subTotal;
     }
 
     std::cout << "Total nodes at depth " << depth << ": " << total << std::endl;
@@ -123,7 +99,7 @@ TEST(BoardTest, DeepCopyPreservesStateAndIsIndependent) {
     for (const auto &[piece, pos] : original.pieceToCoordinate) {
         bool found = false;
         for (const auto &[cpiece, cpos] : copy.pieceToCoordinate) {
-            if (pos == cpos && piece->name == cpiece->name && piece->color == cpiece->color) {
+            if (pos == cpos && piece->type == cpiece->type && piece->color == cpiece->color) {
                 found = true;
                 break;
             }
@@ -134,9 +110,9 @@ TEST(BoardTest, DeepCopyPreservesStateAndIsIndependent) {
     // 3. White and black king pointers are not null
     EXPECT_NE(copy.whiteKing, nullptr);
     EXPECT_NE(copy.blackKing, nullptr);
-    EXPECT_EQ(copy.whiteKing->name, "King");
+    EXPECT_EQ(copy.whiteKing->name(), "King");
     EXPECT_EQ(copy.whiteKing->color, Color::White);
-    EXPECT_EQ(copy.blackKing->name, "King");
+    EXPECT_EQ(copy.blackKing->name(), "King");
     EXPECT_EQ(copy.blackKing->color, Color::Black);
 
     // 4. Changing copy should not affect original
@@ -148,7 +124,7 @@ TEST(BoardTest, DeepCopyPreservesStateAndIsIndependent) {
     // The original should still have the pawn at the old spot
     auto originalPiece = original.getPiece(XYPos(Index::e, 2));
     EXPECT_TRUE(originalPiece.has_value());
-    EXPECT_EQ(originalPiece.value()->name, "Pawn");
+    EXPECT_EQ(originalPiece.value()->name(), "Pawn");
 
     auto movedPieceInOriginal = original.getPiece(XYPos(Index::e, 4));
     EXPECT_FALSE(movedPieceInOriginal.has_value());
@@ -208,7 +184,7 @@ TEST(BoardTest, depth5) {
 TEST(BoardTest, KingsStartInCorrectPositions) {
     Board board;
     for (const auto &[piece, pos] : board.pieceToCoordinate) {
-        if (piece->name == "King") {
+        if (piece->type == KING) {
             if (piece->color == Color::White) {
                 EXPECT_EQ(pos, XYPos(Index::e, 1));
             } else {
@@ -222,12 +198,760 @@ TEST(BoardTest, KnightsHaveTwoMovesAtStart) {
     Board board;
     for (const auto &[piece, pos] : board.pieceToCoordinate) {
         auto moves = board.getValidMoves(piece);
-        if (piece->name == "Knight") {
+        if (piece->type == KNIGHT) {
             EXPECT_EQ(moves.size(), 2);
         }
     }
 }
 
+TEST(BoardTest, CastlingMovesRook) {
+    Board board;
+    std::vector<std::pair<XYPos, XYPos>> moves = {
+        {XYPos("e2"), XYPos("e4")}, {XYPos("e7"), XYPos("e5")},
+        {XYPos("g1"), XYPos("f3")}, {XYPos("b8"), XYPos("c6")},
+        {XYPos("f1"), XYPos("c4")}, {XYPos("g8"), XYPos("f6")}};
+    for (auto &[from, to] : moves) board.movePiece(board.getPiece(from).value(), to);
+    XYPos castle(Index::g, 1);
+    EXPECT_TRUE(board.getValidMoves(board.whiteKing).count(castle));
+    board.movePiece(board.whiteKing, castle);
+    ASSERT_TRUE(board.getPiece(XYPos(Index::f, 1)).has_value());
+    EXPECT_EQ(board.getPiece(XYPos(Index::f, 1)).value()->name(), "Castle");
+    EXPECT_FALSE(board.getPiece(XYPos(Index::h, 1)).has_value());
+}
+
+TEST(BoardTest, MovingARookByHandDropsItsCastlingRight) {
+    Board board = Board::fromFEN("4k3/8/8/8/8/8/8/R3K2R w KQ - 0 1").value();
+    XYPos rookHome("h1"), rookAway("h4");
+    board.updatePiece(board.getPiece(rookHome).value(), rookAway);
+    auto moves = board.getValidMoves(board.whiteKing);
+    EXPECT_FALSE(moves.count(XYPos("g1")));
+    EXPECT_TRUE(moves.count(XYPos("c1")));
+    EXPECT_EQ(board.engine.castling, WHITE_QUEENSIDE);
+
+    // Rights the engine was handed without the rook still never castle onto an empty corner.
+    BitBoard bare;
+    ASSERT_TRUE(bare.setFEN("4k3/8/8/8/8/8/8/R3K3 w Q - 0 1"));
+    bare.setCastling(WHITE_KINGSIDE | WHITE_QUEENSIDE);
+    EXPECT_FALSE(bare.legalTargets(4) & squareBit(6));
+    EXPECT_TRUE(bare.legalTargets(4) & squareBit(2));
+}
+
+TEST(BoardTest, EnPassantRemovesCapturedPawn) {
+    Board board;
+    std::vector<std::pair<XYPos, XYPos>> moves = {
+        {XYPos("e2"), XYPos("e4")}, {XYPos("a7"), XYPos("a6")},
+        {XYPos("e4"), XYPos("e5")}, {XYPos("d7"), XYPos("d5")}};
+    for (auto &[from, to] : moves) board.movePiece(board.getPiece(from).value(), to);
+    XYPos capture("d6");
+    auto pawn = board.getPiece(XYPos("e5")).value();
+    EXPECT_TRUE(board.getValidMoves(pawn).count(capture));
+    board.movePiece(pawn, capture);
+    EXPECT_FALSE(board.getPiece(XYPos("d5")).has_value());
+    EXPECT_EQ(board.pieceToCoordinate.size(), 31);
+    EXPECT_EQ(board.pieceToCoordinate.size(), board.coordinateToPiece.size());
+}
+
+TEST(PieceTest, MovementsComeFromStaticTables) {
+    static_assert(!std::is_polymorphic<Piece>::value, "pieces are plain values");
+    Pawn pawn(Color::White, Index::e);
+    King king(Color::Black, Index::e);
+    EXPECT_EQ(pawn.movements().size(), 4);
+    EXPECT_EQ(king.movements().size(), 10);
+    EXPECT_EQ(pawn.movements().begin(), Pawn::WHITE_OFFSETS.data());
+    pawn.moved = true;
+    king.moved = true;
+    EXPECT_EQ(pawn.movements().size(), 3);
+    EXPECT_EQ(king.movements().size(), 8);
+    EXPECT_TRUE(Queen(Color::White, Index::d).slidingPiece());
+    EXPECT_FALSE(Knight(Color::White, Index::b).slidingPiece());
+}
+
+TEST(BitBoardTest, MagicAttacksMatchRayWalk) {
+    BitBoard bitBoard;
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    for (int trial = 0; trial < 200; ++trial) {
+        bitBoard.clear();
+        for (int square = 0; square < 64; ++square) {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            if (seed % 4 == 0) bitBoard.put(makePiece(Black, PAWN), square);
+        }
+        for (int square = 0; square < 64; ++square) {
+            Bitboard rookRays = bitBoard.slidingAttacks(square, 0, 1) | bitBoard.slidingAttacks(square, 0, -1) |
+                                bitBoard.slidingAttacks(square, 1, 0) | bitBoard.slidingAttacks(square, -1, 0);
+            Bitboard bishopRays = bitBoard.slidingAttacks(square, 1, 1) | bitBoard.slidingAttacks(square, 1, -1) |
+                                  bitBoard.slidingAttacks(square, -1, 1) | bitBoard.slidingAttacks(square, -1, -1);
+            EXPECT_EQ(rookAttacks(square, bitBoard.occupied()), rookRays);
+            EXPECT_EQ(bishopAttacks(square, bitBoard.occupied()), bishopRays);
+            for (int fileStep = -1; fileStep <= 1; ++fileStep)
+                for (int rankStep = -1; rankStep <= 1; ++rankStep)
+                    if (fileStep || rankStep)
+                        EXPECT_EQ(bitBoard.rayAttacks(square, fileStep, rankStep),
+                                  bitBoard.slidingAttacks(square, fileStep, rankStep));
+        }
+    }
+}
+
+TEST(BitBoardTest, PinnedPiecesStayOnTheLine) {
+    BitBoard bitBoard;
+    bitBoard.put(makePiece(White, KING), 4);    // e1
+    bitBoard.put(makePiece(White, BISHOP), 12); // e2
+    bitBoard.put(makePiece(Black, ROOK), 60);   // e8
+    bitBoard.put(makePiece(Black, KING), 63);   // h8
+
+    CheckInfo info = bitBoard.checkInfo(White);
+    EXPECT_EQ(info.checkers, 0);
+    EXPECT_EQ(info.pinned, squareBit(12));
+    EXPECT_EQ(bitBoard.legalTargets(12, info), 0);
+    EXPECT_TRUE(bitBoard.isAttacked(12, Black));
+}
+
+TEST(BoardTest, MoveListOverloadsMatchSets) {
+    Board board;
+    MoveList all;
+    board.getValidMoves(Color::White, all);
+    EXPECT_EQ(all.size(), 20);
+    for (const auto &[piece, pos] : board.pieceToCoordinate) {
+        MoveList moves;
+        board.getValidMoves(piece, moves);
+        EXPECT_EQ(moves.size(), board.getValidMoves(piece).size());
+    }
+    EXPECT_TRUE(all.contains(encodeMove(12, 28, DOUBLE_PUSH))); // e2e4
+    board.movePiece(encodeMove(12, 28, DOUBLE_PUSH));
+    EXPECT_EQ(board.getPiece(XYPos(Index::e, 4)).value()->name(), "Pawn");
+}
+
+TEST(BitBoardTest, PromotionsAreEncodedForEachPiece) {
+    BitBoard bitBoard;
+    bitBoard.put(makePiece(White, KING), 4);  // e1
+    bitBoard.put(makePiece(White, PAWN), 54); // g7
+    bitBoard.put(makePiece(Black, ROOK), 63); // h8
+    bitBoard.put(makePiece(Black, KING), 56); // a8
+    MoveList moves;
+    bitBoard.legalMoves(54, bitBoard.checkInfo(White), moves);
+    EXPECT_EQ(moves.size(), 8);
+    for (Move move : moves) EXPECT_TRUE(isPromotion(move));
+    bitBoard.move(encodeMove(54, 63, CAPTURE | promotionFlags(KNIGHT)));
+    EXPECT_EQ(bitBoard.at(63), makePiece(White, KNIGHT));
+    EXPECT_EQ(bitBoard.bitboard(Black, ROOK), 0);
+}
+
+TEST(BoardTest, UnmakeMoveRestoresPosition) {
+    Board board;
+    std::vector<std::pair<XYPos, XYPos>> moves = {
+        {XYPos("e2"), XYPos("e4")}, {XYPos("d7"), XYPos("d5")}, {XYPos("e4"), XYPos("d5")},
+        {XYPos("g8"), XYPos("f6")}, {XYPos("g1"), XYPos("f3")}, {XYPos("c8"), XYPos("g4")},
+        {XYPos("f1"), XYPos("e2")}, {XYPos("b8"), XYPos("c6")}, {XYPos("e1"), XYPos("g1")}};
+    std::vector<BitBoard> positions;
+    for (auto &[from, to] : moves) {
+        positions.push_back(board.engine);
+        board.movePiece(board.getPiece(from).value(), to);
+    }
+    ASSERT_EQ(board.history.size(), moves.size());
+    while (!board.history.empty()) {
+        board.unmakeMove();
+        EXPECT_EQ(board.engine.mailbox, positions.back().mailbox);
+        EXPECT_EQ(board.engine.castling, positions.back().castling);
+        EXPECT_EQ(board.engine.enPassant, positions.back().enPassant);
+        positions.pop_back();
+    }
+    EXPECT_EQ(board.pieceToCoordinate.size(), 32);
+    EXPECT_FALSE(board.whiteKing->hasMoved());
+    EXPECT_EQ(board.getPiece(XYPos("h1")).value()->name(), "Castle");
+    EXPECT_FALSE(board.getPiece(XYPos("h1")).value()->hasMoved());
+}
+
+TEST(BoardTest, HashTracksPositionIncrementally) {
+    Board board;
+    uint64_t start = board.hash();
+    EXPECT_EQ(start, board.engine.computeHash());
+    std::vector<std::pair<XYPos, XYPos>> moves = {
+        {XYPos("e2"), XYPos("e4")}, {XYPos("d7"), XYPos("d5")}, {XYPos("e4"), XYPos("d5")},
+        {XYPos("c7"), XYPos("c5")}, {XYPos("d5"), XYPos("c6")}, {XYPos("b8"), XYPos("c6")}};
+    for (auto &[from, to] : moves) {
+        board.movePiece(board.getPiece(from).value(), to);
+        EXPECT_EQ(board.hash(), board.engine.computeHash());
+        EXPECT_NE(board.hash(), start);
+    }
+    while (!board.history.empty()) board.unmakeMove();
+    EXPECT_EQ(board.hash(), start);
+}
+
+TEST(BoardTest, TranspositionsShareAHash) {
+    auto play = [](Board &board, std::vector<std::pair<std::string, std::string>> moves) {
+        for (auto &[from, to] : moves) {
+            XYPos dest(to);
+            board.movePiece(board.getPiece(XYPos(from)).value(), dest);
+        }
+    };
+    Board knights;
+    play(knights, {{"g1", "f3"}, {"g8", "f6"}, {"f3", "g1"}, {"f6", "g8"}});
+    EXPECT_EQ(knights.hash(), Board().hash());
+
+    // Same squares and side to move, but only the double push leaves an en passant square behind.
+    Board singles, doubles;
+    play(singles, {{"e2", "e3"}, {"a7", "a6"}, {"e3", "e4"}, {"a6", "a5"}});
+    play(doubles, {{"e2", "e4"}, {"a7", "a5"}});
+    EXPECT_EQ(singles.engine.mailbox, doubles.engine.mailbox);
+    EXPECT_NE(singles.hash(), doubles.hash());
+    play(singles, {{"b1", "c3"}});
+    play(doubles, {{"b1", "c3"}});
+    EXPECT_EQ(singles.hash(), doubles.hash());
+}
+
+uint64_t enginePerft(BitBoard &board, int depth) {
+    MoveList moves;
+    board.legalMoves(board.sideToMove, moves);
+    if (depth == 1) return moves.size();
+    uint64_t total = 0;
+    for (Move move : moves) {
+        Undo undo = board.makeMove(move);
+        total += enginePerft(board, depth - 1);
+        board.unmakeMove(undo);
+    }
+    return total;
+}
+
+TEST(BitBoardTest, KiwipetePerftFromFEN) {
+    BitBoard board;
+    ASSERT_TRUE(board.setFEN("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"));
+    EXPECT_EQ(board.castling, ALL_CASTLING);
+    EXPECT_EQ(board.hash(), board.computeHash());
+    EXPECT_EQ(enginePerft(board, 1), 48);
+    EXPECT_EQ(enginePerft(board, 3), 97862);
+
+    ASSERT_TRUE(board.setFEN("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - -"));
+    EXPECT_EQ(enginePerft(board, 4), 43238);
+}
+
+TEST(BitBoardTest, PawnsOnTheLastRankHaveNoMoves) {
+    BitBoard board;
+    board.put(makePiece(White, KING), 4);
+    board.put(makePiece(Black, KING), 60);
+    board.put(makePiece(White, PAWN), 58);
+    board.put(makePiece(Black, PAWN), 1);
+    EXPECT_EQ(board.pseudoTargets(58), 0u);
+    EXPECT_EQ(board.pseudoTargets(1), 0u);
+    EXPECT_EQ(board.legalTargets(58), 0u);
+}
+
+TEST(BitBoardTest, MalformedFENIsRejected) {
+    BitBoard board;
+    board.setInitial();
+    uint64_t start = board.hash();
+    EXPECT_FALSE(board.setFEN(""));
+    EXPECT_FALSE(board.setFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP w KQkq -"));
+    EXPECT_FALSE(board.setFEN("rnbqkbnr/pppppppp/9/8/8/8/PPPPPPPP/RNBQKBNR w KQkq -"));
+    EXPECT_FALSE(board.setFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR x KQkq -"));
+    EXPECT_FALSE(board.setFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQ1BNR w KQkq -"));
+    EXPECT_FALSE(board.setFEN("rnbqkbnP/pppppppp/8/8/8/8/PPPPPPP1/RNBQKBNR w KQkq - 0 1"));
+    EXPECT_FALSE(board.setFEN("4k3/8/8/8/8/8/8/p3K3 w - - 0 1"));
+    EXPECT_FALSE(board.setFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - x 1"));
+    EXPECT_FALSE(board.setFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 one"));
+    EXPECT_FALSE(board.setFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - -1 1"));
+    EXPECT_EQ(board.hash(), start);
+    EXPECT_EQ(moveToUci(encodeMove(12, 28, DOUBLE_PUSH)), "e2e4");
+    EXPECT_EQ(moveToUci(encodeMove(52, 61, promotionFlags(KNIGHT) | CAPTURE)), "e7f8n");
+}
+
+TEST(BoardTest, FENRoundTrips) {
+    const char *fens[] = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 b - - 12 40"};
+    for (const char *fen : fens) {
+        auto board = Board::fromFEN(fen);
+        ASSERT_TRUE(board.has_value()) << fen;
+        EXPECT_EQ(board->toFEN(), fen);
+        EXPECT_EQ(board->hash(), board->engine.computeHash());
+    }
+    EXPECT_EQ(Board().toFEN(), fens[0]);
+}
+
+TEST(BoardTest, FENSetsUpPieceHandles) {
+    auto board = Board::fromFEN("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    ASSERT_TRUE(board.has_value());
+    EXPECT_EQ(board->pieceToCoordinate.size(), 32);
+    EXPECT_EQ(board->getKingPosition(Color::Black), XYPos("e8"));
+    EXPECT_EQ(moveGenerationTest(board.value(), 2, Color::White), 2039);
+    EXPECT_FALSE(board->getPiece(XYPos("a2")).value()->hasMoved());
+    EXPECT_TRUE(board->getPiece(XYPos("d5")).value()->hasMoved());
+
+    // A right the rooks can't back up is dropped rather than letting the king castle alone.
+    auto noRook = Board::fromFEN("4k3/8/8/8/8/8/8/4K2R w KQ - 0 1");
+    ASSERT_TRUE(noRook.has_value());
+    EXPECT_EQ(noRook->engine.castling, WHITE_KINGSIDE);
+    EXPECT_FALSE(Board::fromFEN("not a fen").has_value());
+}
+
+TEST(BoardTest, MovesAdvanceTheFENCounters) {
+    Board board;
+    auto play = [&](const char *from, const char *to) {
+        XYPos dest(to);
+        board.movePiece(board.getPiece(XYPos(from)).value(), dest);
+    };
+    play("g1", "f3");
+    play("g8", "f6");
+    play("f3", "g1");
+    EXPECT_EQ(board.toFEN(), "rnbqkb1r/pppppppp/5n2/8/8/8/PPPPPPPP/RNBQKBNR b KQkq - 3 2");
+    play("e7", "e5");
+    EXPECT_EQ(board.toFEN(), "rnbqkb1r/pppp1ppp/5n2/4p3/8/8/PPPPPPPP/RNBQKBNR w KQkq e6 0 3");
+    board.unmakeMove();
+    board.unmakeMove();
+    EXPECT_EQ(board.toFEN(), "rnbqkb1r/pppppppp/5n2/8/8/5N2/PPPPPPPP/RNBQKB1R w KQkq - 2 2");
+}
+
+TEST(SessionManagerTest, GamesAreIndependentAndPooled) {
+    SessionManager sessions;
+    std::string first = sessions.create(), second = sessions.create();
+    ASSERT_NE(first, second);
+    auto game = sessions.find(first);
+    game->position.makeMove(game->position.encode(12, 28));
+    EXPECT_NE(game->position.hash(), sessions.find(second)->position.hash());
+    EXPECT_EQ(sessions.find("missing"), nullptr);
+
+    // The block of an erased game is handed straight to the next one.
+    const Game *address = game.get();
+    game.reset();
+    EXPECT_TRUE(sessions.erase(first));
+    EXPECT_EQ(sessions.find(sessions.create()).get(), address);
+    EXPECT_EQ(sessions.size(), 2);
+}
+
+TEST(SessionManagerTest, EventLogKeepsOnlyTheLatestMoves) {
+    Game game;
+    for (size_t i = 0; i < Game::EVENT_HISTORY + 10; ++i) game.record({encodeMove(12, 28, DOUBLE_PUSH), i});
+    EXPECT_EQ(game.events.size(), Game::EVENT_HISTORY);
+    EXPECT_EQ(game.firstEvent(), 10u);
+    EXPECT_EQ(game.nextEvent(), Game::EVENT_HISTORY + 10);
+    EXPECT_EQ(game.event(10).hash, 10u); // ids keep counting every move
+    EXPECT_EQ(game.event(Game::EVENT_HISTORY + 9).hash, Game::EVENT_HISTORY + 9);
+}
+
+TEST(SearchTest, FindsMateAndWinsMaterial) {
+    Search search(1 << 16);
+    SearchLimits limits;
+    limits.timeMs = 2000;
+    limits.maxDepth = 4;
+
+    // Back-rank mate: Re8#.
+    auto mate = Board::fromFEN("6k1/5ppp/8/8/8/8/8/4R1K1 w - - 0 1");
+    SearchResult result = search.think(mate.value(), limits);
+    EXPECT_EQ(moveToUci(result.best), "e1e8");
+    EXPECT_EQ(result.score, MATE_SCORE - 1);
+
+    // The knight on d4 is attacked by a pawn and defended by nothing; black takes it.
+    auto hanging = Board::fromFEN("4k3/8/8/4p3/3N4/8/8/4K3 b - - 0 1");
+    result = search.think(hanging.value(), limits);
+    EXPECT_EQ(moveToUci(result.best), "e5d4");
+    EXPECT_GT(result.depth, 0);
+    EXPECT_GT(result.nodes, 0);
+}
+
+TEST(SearchTest, ReportsEveryIteration) {
+    Search search(1 << 16);
+    SearchLimits limits;
+    limits.maxDepth = 3;
+    std::vector<int> depths;
+    search.onIteration = [&](const SearchResult &info) { depths.push_back(info.depth); };
+    SearchResult result = search.think(Board(), limits);
+    EXPECT_EQ(depths, std::vector<int>({1, 2, 3}));
+    MoveList legal;
+    Board().engine.legalMoves(White, legal);
+    EXPECT_TRUE(legal.contains(result.best));
+
+    auto stalemate = Board::fromFEN("7k/5Q2/6K1/8/8/8/8/8 b - - 0 1");
+    EXPECT_EQ(search.think(stalemate.value(), limits).best, NO_MOVE);
+}
+
+TEST(SearchTest, SingleThreadIsDeterministicAndHelpersAgreeOnLegality) {
+    auto board = Board::fromFEN("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    SearchLimits limits;
+    limits.timeMs = 60000;
+    limits.maxDepth = 4;
+    SearchResult first = Search(1 << 16).think(board.value(), limits);
+    SearchResult second = Search(1 << 16).think(board.value(), limits);
+    EXPECT_EQ(first.best, second.best);
+    EXPECT_EQ(first.nodes, second.nodes);
+    EXPECT_EQ(first.score, second.score);
+
+    limits.threads = 4;
+    SearchResult parallel = Search(1 << 16).think(board.value(), limits);
+    MoveList legal;
+    board->engine.legalMoves(White, legal);
+    EXPECT_TRUE(legal.contains(parallel.best));
+    EXPECT_EQ(parallel.depth, 4);
+}
+
+TEST(GrblControllerTest, StreamsWithinTheReceiveBufferAndBlendsSegments) {
+    GrblSim sim;
+    GrblController grbl(sim);
+    // 40 segments zigzagging between the axes: far more than fits in either the receive buffer or the planner.
+    for (int i = 1; i <= 40; ++i) grbl.moveTo(i % 2 ? i * 5.0f : sim.x, i % 2 ? sim.y : i * 5.0f, 3000);
+    grbl.moveTo(30, 30);
+    bool finished = false;
+    grbl.onIdle([&] { finished = true; });
+
+    uint32_t now = 0;
+    while (!finished && now < 600000) {
+        grbl.poll(now);
+        sim.advance(1);
+        ++now;
+    }
+    ASSERT_TRUE(finished);
+    EXPECT_FALSE(sim.overflowed);
+    EXPECT_EQ(sim.motionStarts, 1); // never ran dry between segments
+    EXPECT_EQ(sim.maxPlanned, GrblSim::PLANNER_BLOCKS);
+    EXPECT_EQ(grbl.pending(), 0);
+    EXPECT_FLOAT_EQ(grbl.status().x, 30);
+    EXPECT_FLOAT_EQ(grbl.status().y, 30);
+}
+
+TEST(GrblControllerTest, OnIdleWaitsForMotionAndCanChainLegs) {
+    GrblSim sim;
+    GrblController grbl(sim);
+    std::vector<std::string> log;
+    grbl.moveTo(90, 30);
+    grbl.onIdle([&] {
+        log.push_back("picked up at " + std::to_string(int(sim.x)));
+        grbl.moveTo(90, 150, 2000);
+        grbl.onIdle([&] { log.push_back("dropped at " + std::to_string(int(sim.y))); });
+    });
+
+    for (uint32_t now = 0; now < 20000 && log.size() < 2; now += 5) {
+        grbl.poll(now);
+        if (log.empty()) {
+            EXPECT_NE(grbl.status().state, GrblState::Idle) << "reported idle before moving";
+        }
+        sim.advance(5);
+    }
+    EXPECT_EQ(log, std::vector<std::string>({"picked up at 90", "dropped at 150"}));
+    EXPECT_TRUE(grbl.idle());
+    EXPECT_EQ(grbl.errors(), 0);
+}
+
+TEST(GrblControllerTest, ClearDropsTheRestOfAnAbandonedMove) {
+    GrblSim sim;
+    GrblController grbl(sim);
+    std::vector<std::string> log;
+    grbl.moveTo(90, 30);
+    grbl.onIdle([&] {
+        log.push_back("picked up");
+        grbl.moveTo(90, 150, 2000);
+        grbl.onIdle([&] { log.push_back("dropped"); });
+    });
+    grbl.poll(0);
+    sim.advance(5);
+
+    grbl.clear();
+    grbl.onIdle([&] { log.push_back("stopped at " + std::to_string(int(sim.x)) + "," + std::to_string(int(sim.y))); });
+    for (uint32_t now = 5; now < 20000 && log.empty(); now += 5) {
+        grbl.poll(now);
+        sim.advance(5);
+    }
+    // The move already sent finished; the carry after it never started.
+    EXPECT_EQ(log, std::vector<std::string>({"stopped at 90,30"}));
+    EXPECT_EQ(grbl.pending(), 0);
+    EXPECT_EQ(grbl.errors(), 0);
+}
+
+// True if any point of the path lies strictly inside an occupied square other than the two endpoints.
+static bool crossesPieces(const std::vector<Waypoint> &path, uint64_t occupied, int from, int to) {
+    for (size_t i = 1; i < path.size(); ++i) {
+        for (int t = 0; t <= 100; ++t) {
+            float x = path[i - 1].x + (path[i].x - path[i - 1].x) * t / 100;
+            float y = path[i - 1].y + (path[i].y - path[i - 1].y) * t / 100;
+            if (x >= 8 * PathPlanner::SQUARE_MM) continue; // the graveyard beyond the h-file
+            float fx = std::fmod(x, PathPlanner::SQUARE_MM), fy = std::fmod(y, PathPlanner::SQUARE_MM);
+            if (fx < 1 || fx > PathPlanner::SQUARE_MM - 1 || fy < 1 || fy > PathPlanner::SQUARE_MM - 1) continue;
+            int square = int(y / PathPlanner::SQUARE_MM) * 8 + int(x / PathPlanner::SQUARE_MM);
+            if (square != from && square != to && (occupied >> square & 1)) return true;
+        }
+    }
+    return false;
+}
+
+TEST(PathPlannerTest, GoesStraightThroughEmptySquares) {
+    Board board;
+    // e2-e4 and the diagonal a1-h8 on an empty board are single segments.
+    auto path = PathPlanner::route(12, 28, board.engine.occupied());
+    EXPECT_EQ(path, std::vector<Waypoint>({PathPlanner::squareCenter(12), PathPlanner::squareCenter(28)}));
+    path = PathPlanner::route(0, 63, 0);
+    EXPECT_EQ(path, std::vector<Waypoint>({PathPlanner::squareCenter(0), PathPlanner::squareCenter(63)}));
+    EXPECT_EQ(PathPlanner::toGcode(path, 3000), "G1 X450.0 Y450.0 F3000\n");
+}
+
+TEST(PathPlannerTest, DetoursAlongLanesAroundPieces) {
+    uint64_t occupied = Board().engine.occupied();
+    // Knights g1-f3 and b1-c3, rooks a1-a4 and a1-d5: every one is boxed in and has to leave along the lanes.
+    for (auto [from, to] : {std::pair<int, int>{6, 21}, {1, 18}, {0, 24}, {0, 35}}) {
+        auto path = PathPlanner::route(from, to, occupied);
+        ASSERT_GE(path.size(), 3);
+        EXPECT_EQ(path.front(), PathPlanner::squareCenter(from));
+        EXPECT_EQ(path.back(), PathPlanner::squareCenter(to));
+        EXPECT_FALSE(crossesPieces(path, occupied, from, to));
+    }
+    EXPECT_TRUE(crossesPieces({PathPlanner::squareCenter(0), PathPlanner::squareCenter(24)}, occupied, 0, 24));
+}
+
+// Plays the legs on an occupancy bitboard, checking each one only crosses empty squares.
+static void expectLegsClear(const std::vector<CncLeg> &legs, uint64_t occupied) {
+    auto squareAt = [](Waypoint p) {
+        if (p.x >= 8 * PathPlanner::SQUARE_MM) return -1;
+        return int(p.y / PathPlanner::SQUARE_MM) * 8 + int(p.x / PathPlanner::SQUARE_MM);
+    };
+    for (const CncLeg &leg : legs) {
+        int from = squareAt(leg.path.front()), to = squareAt(leg.path.back());
+        ASSERT_TRUE(from < 0 || (occupied >> from & 1)) << "nothing to pick up";
+        ASSERT_TRUE(to < 0 || !(occupied >> to & 1)) << "landing on a piece";
+        EXPECT_FALSE(crossesPieces(leg.path, occupied, from, to));
+        if (from >= 0) occupied &= ~(1ULL << from);
+        if (to >= 0) occupied |= 1ULL << to;
+    }
+}
+
+TEST(CncMovePlannerTest, CapturesAndCastlingBecomeOrderedLegs) {
+    CncMovePlanner planner;
+    Waypoint home{0, 0};
+
+    auto capture = Board::fromFEN("4k3/8/8/3p4/4P3/8/8/4K3 w - - 0 1").value();
+    Move exd5 = CncMovePlanner::inferMove(capture.engine, 28, 35);
+    EXPECT_EQ(exd5, encodeMove(28, 35, CAPTURE));
+    auto legs = planner.plan(capture.engine, exd5, home);
+    ASSERT_EQ(legs.size(), 2);
+    EXPECT_EQ(legs[0].path.front(), PathPlanner::squareCenter(35));
+    EXPECT_EQ(legs[0].path.back(), CncMovePlanner::slotCenter(Black, 4)); // the slot level with d5
+    EXPECT_EQ(planner.slotPiece(Black, 4), makePiece(Black, PAWN));
+    EXPECT_EQ(legs[1].path, std::vector<Waypoint>({PathPlanner::squareCenter(28), PathPlanner::squareCenter(35)}));
+    expectLegsClear(legs, capture.engine.occupied());
+
+    auto castle = Board::fromFEN("r3k2r/pppppppp/8/8/8/8/PPPPPPPP/R3K2R w KQkq - 0 1").value();
+    for (int to : {6, 2}) {
+        Move move = CncMovePlanner::inferMove(castle.engine, 4, to);
+        EXPECT_EQ(moveFlags(move), to == 6 ? KING_CASTLE : QUEEN_CASTLE);
+        legs = planner.plan(castle.engine, move, home);
+        ASSERT_EQ(legs.size(), 2);
+        expectLegsClear(legs, castle.engine.occupied());
+    }
+
+    auto enPassant = Board::fromFEN("4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1").value();
+    Move exd6 = CncMovePlanner::inferMove(enPassant.engine, 36, 43);
+    EXPECT_EQ(moveFlags(exd6), EN_PASSANT);
+    legs = planner.plan(enPassant.engine, exd6, home);
+    ASSERT_EQ(legs.size(), 2);
+    expectLegsClear(legs, enPassant.engine.occupied());
+}
+
+TEST(CncMovePlannerTest, PromotionBringsBackACapturedPiece) {
+    CncMovePlanner planner;
+    planner.swapPromotions = true;
+    auto before = Board::fromFEN("3qk3/P7/8/8/8/8/8/3QK3 b - - 0 1").value();
+    planner.plan(before.engine, CncMovePlanner::inferMove(before.engine, 59, 3), {0, 0}); // ...Qxd1
+    auto position = Board::fromFEN("4k3/P7/8/8/8/8/8/3qK3 w - - 0 1").value();
+
+    Move promotion = CncMovePlanner::inferMove(position.engine, 48, 56);
+    EXPECT_EQ(promotionType(promotion), QUEEN);
+    auto legs = planner.plan(position.engine, promotion, {0, 0});
+    ASSERT_EQ(legs.size(), 2);
+    EXPECT_EQ(legs[0].path.front(), PathPlanner::squareCenter(48));
+    EXPECT_EQ(legs[1].path.back(), PathPlanner::squareCenter(56));
+    EXPECT_GE(legs[1].path.front().x, 8 * PathPlanner::SQUARE_MM);
+    expectLegsClear(legs, position.engine.occupied());
+
+    // The queen is back on the board and the pawn sits in the graveyard instead.
+    int pawns = 0, queens = 0;
+    for (int slot = 0; slot < CncMovePlanner::GRAVEYARD_SLOTS; ++slot) {
+        pawns += planner.slotPiece(White, slot) == makePiece(White, PAWN);
+        queens += planner.slotPiece(White, slot) == makePiece(White, QUEEN);
+    }
+    EXPECT_EQ(pawns, 1);
+    EXPECT_EQ(queens, 0);
+
+    // A second promotion finds no queen to swap in, so the pawn goes straight to the square.
+    legs = planner.plan(position.engine, promotion, {0, 0});
+    ASSERT_EQ(legs.size(), 1);
+    EXPECT_EQ(legs[0].path.back(), PathPlanner::squareCenter(56));
+
+    // Without swapping, the pawn always goes up even with a queen waiting in the graveyard.
+    CncMovePlanner firmware;
+    firmware.plan(before.engine, CncMovePlanner::inferMove(before.engine, 59, 3), {0, 0});
+    legs = firmware.plan(position.engine, promotion, {0, 0});
+    ASSERT_EQ(legs.size(), 1);
+    EXPECT_EQ(legs[0].path.front(), PathPlanner::squareCenter(48));
+}
+
+TEST(MotionProfileTest, SlowsDownOnlyNearOtherPieces) {
+    MotionProfiles profiles;
+    // A queen crossing an empty board goes in one line at its open profile.
+    CncLeg open{PathPlanner::route(0, 63, 0), makePiece(White, QUEEN), 0};
+    EXPECT_EQ(profiles.program(open), "G1 X450.0 Y450.0 F3000\n");
+
+    // Squeezing the g1 knight out between the pawns is gentle; the run across the empty middle is not.
+    uint64_t occupied = Board().engine.occupied();
+    CncLeg knight{PathPlanner::route(6, 45, occupied), makePiece(White, KNIGHT), occupied & ~(1ULL << 6)};
+    std::string program = profiles.program(knight);
+    EXPECT_NE(program.find("F" + std::to_string(profiles.carry[KNIGHT][true])), std::string::npos);
+    EXPECT_NE(program.find("F" + std::to_string(profiles.carry[KNIGHT][false])), std::string::npos);
+
+    EXPECT_TRUE(profiles.set("knight.congested=1000"));
+    EXPECT_EQ(profiles.carry[KNIGHT][true], 1000);
+    EXPECT_FALSE(profiles.set("knight.congested=fast"));
+    EXPECT_EQ(profiles.carry[KNIGHT][true], 1000);
+    EXPECT_TRUE(profiles.set("acceleration=300"));
+    EXPECT_EQ(profiles.acceleration, 300);
+    EXPECT_FALSE(profiles.set("acceleration=0"));
+    EXPECT_EQ(profiles.acceleration, 300);
+    EXPECT_EQ(profiles.travelFeedRate, 0);
+    EXPECT_TRUE(profiles.set("travel=9000"));
+    EXPECT_EQ(profiles.travelFeedRate, 9000);
+    EXPECT_FALSE(profiles.set("knight.fast=1"));
+    EXPECT_FALSE(profiles.set("dragon.open=1"));
+}
+
+TEST(GrblControllerTest, AccelerationIsOnlySentWhenItChanges) {
+    GrblSim sim;
+    GrblController grbl(sim);
+    auto runUntilIdle = [&] {
+        bool idle = false;
+        grbl.onIdle([&] { idle = true; });
+        for (uint32_t now = 0; !idle && now < 60000; ++now) {
+            grbl.poll(now);
+            sim.advance(1);
+        }
+    };
+    grbl.setAcceleration(250);
+    grbl.moveTo(100, 0, 3000);
+    runUntilIdle();
+    EXPECT_FLOAT_EQ(sim.acceleration, 250);
+    grbl.setAcceleration(250);
+    EXPECT_EQ(grbl.pending(), 0);
+
+    // GRBL refuses settings mid-move, which is why the firmware only changes them from onIdle.
+    grbl.moveTo(0, 0, 3000);
+    grbl.setAcceleration(800);
+    runUntilIdle();
+    EXPECT_EQ(grbl.errors(), 2); // $120 and $121
+    EXPECT_FLOAT_EQ(sim.acceleration, 250);
+
+    // Abandoning a move drops only motion, so the value GRBL already stores isn't written again.
+    grbl.setAcceleration(250);
+    runUntilIdle();
+    grbl.moveTo(50, 50, 3000);
+    grbl.moveTo(0, 0, 3000);
+    grbl.clear();
+    grbl.setAcceleration(250);
+    EXPECT_EQ(grbl.pending(), 0);
+}
+
+TEST(ScanSchedulerTest, HotSquaresArePolledWithinAFewPollsAndEverySquareEventually) {
+    ScanScheduler scheduler;
+    Bitboard hot = squareBit(12) | squareBit(20) | squareBit(28); // e2, e3, e4
+    scheduler.setHot(hot);
+
+    uint64_t seen = 0;
+    std::array<int, 64> lastPoll;
+    lastPoll.fill(-1);
+    int worstGap = 0;
+    for (int poll = 0; poll < 512; ++poll) {
+        int square = scheduler.next(0);
+        ASSERT_GE(square, 0);
+        ASSERT_LT(square, 64);
+        if (hot & squareBit(square)) {
+            if (lastPoll[square] >= 0) worstGap = std::max(worstGap, poll - lastPoll[square]);
+            lastPoll[square] = poll;
+        }
+        seen |= squareBit(square);
+    }
+    EXPECT_EQ(seen, ~0ULL);
+    EXPECT_LE(worstGap, 8);
+}
+
+TEST(ScanSchedulerTest, ChangedSquaresStayRecentForAWhile) {
+    ScanScheduler scheduler;
+    for (int i = 0; i < 64; ++i) EXPECT_EQ(scheduler.next(0), i); // nothing expected: a plain sweep
+
+    scheduler.changed(35, 1000);
+    int recentPolls = 0;
+    for (int poll = 0; poll < 16; ++poll) recentPolls += scheduler.next(1500) == 35;
+    EXPECT_GE(recentPolls, 2);
+
+    scheduler.next(1000 + ScanScheduler::RECENT_MS + 1);
+    EXPECT_EQ(scheduler.recent(), 0u);
+}
+
+TEST(ReaderHealthTest, ReadersAreInitialisedOnceUntilTheyFailOrTheIntervalPasses) {
+    ReaderHealth health(1000);
+    EXPECT_TRUE(health.needsInit(28, 0));
+    health.initialized(28, 0, true);
+    EXPECT_FALSE(health.needsInit(28, 999));
+    EXPECT_TRUE(health.needsInit(28, 1000));
+    EXPECT_TRUE(health.needsInit(27, 10)); // the others are still to do
+
+    health.initialized(28, 1000, true);
+    health.lost(28);
+    EXPECT_TRUE(health.needsInit(28, 1001));
+    health.initialized(28, 1001, false); // still broken: try again next visit
+    EXPECT_TRUE(health.needsInit(28, 1002));
+    EXPECT_EQ(health[28].inits, 3u);
+    EXPECT_EQ(health[28].failures, 2u);
+
+    health.polled(28);
+    health.polled(0);
+    EXPECT_EQ(health.report(), "polls=2 inits=3 failures=2 e4:2");
+
+    ReaderHealth untimed(0);
+    untimed.initialized(0, 0, true);
+    EXPECT_FALSE(untimed.needsInit(0, 0xFFFFFFFF));
+    untimed.invalidate();
+    EXPECT_TRUE(untimed.needsInit(0, 1));
+}
+
+// Models the select chain: output 0 takes each clocked bit and the rest move one along.
+struct ChainModel : ShiftChain {
+    uint64_t outputs = 0;
+    int clocks = 0;
+
+    void write(const uint8_t *bytes, size_t count) override {
+        for (size_t i = 0; i < count; ++i) {
+            for (int bit = 7; bit >= 0; --bit) outputs = outputs << 1 | ((bytes[i] >> bit) & 1);
+        }
+        clocks += count * 8;
+    }
+    void clockZeros(int count) override {
+        ASSERT_GE(count, 1);
+        ASSERT_LE(count, ReaderSelect::MAX_STEP);
+        outputs <<= count;
+        clocks += count;
+    }
+};
+
+TEST(ReaderSelectTest, SweepsStepTheBitAlongAndJumpsRewriteTheChain) {
+    ChainModel chain;
+    ReaderSelect select(chain);
+    for (int sweep = 0; sweep < 2; ++sweep) {
+        for (int reader = 0; reader < 64; ++reader) {
+            select.select(reader);
+            ASSERT_EQ(chain.outputs, squareBit(reader));
+        }
+    }
+    EXPECT_EQ(select.writes(), 2u); // into the first square of each sweep
+    EXPECT_EQ(chain.clocks, 2 * 64 + 2 * 63);
+
+    for (int reader : {28, 28, 35, 60, 3, 63, 0}) {
+        select.select(reader);
+        ASSERT_EQ(chain.outputs, squareBit(reader));
+    }
+    EXPECT_EQ(select.writes(), 6u); // 28 -> 35 -> 60 step; 3 and 0 are behind and 3 -> 63 is too far
+
+    select.forget();
+    select.select(1);
+    EXPECT_EQ(select.writes(), 7u);
+    EXPECT_EQ(chain.outputs, squareBit(1));
+}
+
 
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);